@@ -0,0 +1,70 @@
+#include "bench/alloc_count.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// The replacement operators are kept in their own translation unit: inlined into a caller, GCC pairs the free of
+// operator delete with the allocation of operator new and reports them as mismatched (-Wmismatched-new-delete).
+// Every replaceable form is defined so that each allocation and deallocation goes through malloc and free.
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+void* counted_alloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+} // namespace
+
+size_t geometry_map_reader::bench::allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    if (void* ptr = counted_alloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+    if (void* ptr = counted_alloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
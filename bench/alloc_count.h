@@ -0,0 +1,16 @@
+#ifndef GEOMETRY_MAP_READER_ALLOC_COUNT_H
+#define GEOMETRY_MAP_READER_ALLOC_COUNT_H
+
+#include <cstddef>
+
+namespace geometry_map_reader::bench {
+
+/**
+ * @return the number of heap allocations made by the process so far, counted by the replacement operator new of
+ * the benchmarks
+ */
+size_t allocation_count();
+
+} // namespace geometry_map_reader::bench
+
+#endif // GEOMETRY_MAP_READER_ALLOC_COUNT_H
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include "bench/synthetic_tree.h"
+#include "geometry_index.h"
+
+namespace {
+
+using namespace geometry_map_reader;
+
+/**
+ * Arguments of the synthetic tree benchmarks: depth, fan-out and leaf size
+ */
+void tree_shapes(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"depth", "fanout", "leaf"});
+    bench->ArgsProduct({{1, 3, 5}, {4, 8}, {16}});
+}
+
+void BM_IndexBuild(benchmark::State& state) {
+    bench::SyntheticTree tree{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)),
+                              static_cast<size_t>(state.range(2))};
+    size_t leaves = 0;
+    for (auto _ : state) {
+        GeometryIndex index = tree.build_index();
+        leaves = index.size();
+        benchmark::DoNotOptimize(index);
+    }
+    state.counters["leaves"] = static_cast<double>(leaves);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * leaves));
+}
+BENCHMARK(BM_IndexBuild)->Apply(tree_shapes);
+
+void BM_IndexFind(benchmark::State& state) {
+    bench::SyntheticTree tree{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)),
+                              static_cast<size_t>(state.range(2))};
+    GeometryIndex index = tree.build_index();
+    std::vector<std::string> keys;
+    for (const auto& key : tree.keys) {
+        keys.push_back(key + ".values");
+    }
+
+    size_t next = 0;
+    for (auto _ : state) {
+        const GeometryLeaf* leaf = index.find(keys[next]);
+        benchmark::DoNotOptimize(leaf);
+        next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IndexFind)->Apply(tree_shapes);
+
+/**
+ * Visit every leaf in tree order, the traversal done when indexing or storing a tree
+ */
+void BM_IndexTraverse(benchmark::State& state) {
+    bench::SyntheticTree tree{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)),
+                              static_cast<size_t>(state.range(2))};
+    GeometryIndex index = tree.build_index();
+
+    for (auto _ : state) {
+        size_t bytes = 0;
+        index.for_each_leaf(
+            [&](std::string_view key, const GeometryLeaf& leaf) { bytes += key.size() + leaf.count(); });
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * index.size()));
+}
+BENCHMARK(BM_IndexTraverse)->Apply(tree_shapes);
+
+void BM_IndexGlob(benchmark::State& state) {
+    bench::SyntheticTree tree{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)),
+                              static_cast<size_t>(state.range(2))};
+    GeometryIndex index = tree.build_index();
+
+    for (auto _ : state) {
+        size_t matches = 0;
+        index.for_each_match("**.values", [&](std::string_view, const GeometryLeaf&) { ++matches; });
+        benchmark::DoNotOptimize(matches);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * index.size()));
+}
+BENCHMARK(BM_IndexGlob)->Apply(tree_shapes);
+
+} // namespace
@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/alloc_count.h"
+#include "geometry_plugin.h"
+#include "geometry_source_memory.h"
+#include "tests/plugin_request.h"
+
+namespace {
+
+using namespace geometry_map_reader;
+
+/**
+ * Synthetic tree of coils each holding a few geometry arrays
+ */
+std::shared_ptr<const MemoryTreeNode> make_tree(size_t coils) {
+    const std::vector<double> values(64, 1.0);
+    auto tree = std::make_shared<MemoryTreeNode>("data");
+    for (size_t coil = 0; coil < coils; ++coil) {
+        auto& geometry = tree->add_child("coil_" + std::to_string(coil)).add_child("geometry");
+        for (const char* name : {"r", "z", "dr", "dz", "turns"}) {
+            geometry.add_array<double>(name, values, {values.size()});
+        }
+    }
+    return tree;
+}
+
+/**
+ * GEOMETRY::get of a key of an already cached tree, through the plugin's request handling: argument parsing,
+ * the negative cache and tree cache lookups, the key resolution and the returned data.
+ */
+void BM_CachedLookup(benchmark::State& state) {
+    GeometryMapReaderPlugin plugin;
+    test::PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    PluginStats stats;
+    MemoryGeometrySource memory{stats};
+    memory.add(45272, "/magnetics/pfcoil/d1_upper", 1, make_tree(static_cast<size_t>(state.range(0))));
+    plugin.set_source(GeometryBackend::Uda, &memory);
+
+    test::PluginRequest get{"get",
+                            {{"host", "geom.server.example"},
+                             {"port", "56565"},
+                             {"source", "45272"},
+                             {"signal", "/MAGNETICS/PFCOIL/D1_UPPER"},
+                             {"config", "1"},
+                             {"key", "coil_7.geometry.turns"}}};
+    if (plugin.get(get.interface()) != 0) {
+        state.SkipWithError("GEOMETRY::get failed");
+        return;
+    }
+    get.clear();
+
+    size_t start = bench::allocation_count();
+    for (auto _ : state) {
+        int err = plugin.get(get.interface());
+        benchmark::DoNotOptimize(err);
+        get.clear();
+    }
+    auto allocations = static_cast<double>(bench::allocation_count() - start);
+    state.counters["allocs_per_lookup"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+
+    plugin.reset(init.interface());
+}
+BENCHMARK(BM_CachedLookup)->Arg(10)->Arg(1000);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,186 @@
+#include <benchmark/benchmark.h>
+
+#include <clientserver/initStructs.h>
+#include <clientserver/udaStructs.h>
+
+#include <cstdlib>
+#include <numeric>
+#include <valarray>
+#include <vector>
+
+#include "bench/synthetic_tree.h"
+#include "geometry_return.h"
+#include "utils/uda_plugin_helpers.hpp"
+
+namespace {
+
+using namespace geometry_map_reader;
+namespace helpers = imas_json_plugin::uda_helpers;
+
+/**
+ * Free the data and dimensions set by the setReturnData* helpers, which only use compressed dimensions
+ */
+void release(DATA_BLOCK& data_block) {
+    free(data_block.data);
+    free(data_block.dims);
+    data_block.data = nullptr;
+    data_block.dims = nullptr;
+}
+
+/**
+ * Return a rank 1 or rank 2 leaf of the given size in C (order=0) or Fortran (order=1) element order
+ */
+void BM_SetReturnData(benchmark::State& state) {
+    const auto leaf_size = static_cast<size_t>(state.range(0));
+    bench::SyntheticTree tree{1, 1, leaf_size};
+    GeometryIndex index = tree.build_index();
+    const GeometryLeaf* leaf = index.find(state.range(1) == 1 ? "n0.values" : "n0.grid");
+    ReturnOptions options;
+    options.fortran_order = state.range(2) == 1;
+
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        set_return_data(&data_block, *leaf, options);
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * leaf->count() * sizeof(double)));
+}
+BENCHMARK(BM_SetReturnData)
+    ->ArgNames({"leaf", "rank", "order"})
+    ->ArgsProduct({{16, 1024, 65536}, {1, 2}, {0, 1}});
+
+/**
+ * Return a rank 1 double leaf of the given size as stored (dtype=0), as float32 (1) or as int32 (2), with and
+ * without precision loss reporting
+ */
+void BM_SetReturnDataDtype(benchmark::State& state) {
+    const auto leaf_size = static_cast<size_t>(state.range(0));
+    bench::SyntheticTree tree{1, 1, leaf_size};
+    GeometryIndex index = tree.build_index();
+    const GeometryLeaf* leaf = index.find("n0.values");
+    ReturnOptions options;
+    const UDA_TYPE dtypes[] = {UDA_TYPE_UNKNOWN, UDA_TYPE_FLOAT, UDA_TYPE_INT};
+    options.dtype = dtypes[state.range(1)];
+    options.report_loss = state.range(2) == 1;
+
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        set_return_data(&data_block, *leaf, options);
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * leaf->count() * sizeof(double)));
+}
+BENCHMARK(BM_SetReturnDataDtype)
+    ->ArgNames({"leaf", "dtype", "report"})
+    ->ArgsProduct({{1024, 65536}, {0, 1, 2}, {0, 1}});
+
+/**
+ * Return the sum (op=1), minimum (2), mean (4), argmax (6) or range (7) of a rank 1 double leaf, see ReduceOp
+ */
+void BM_SetReturnDataReduce(benchmark::State& state) {
+    const auto leaf_size = static_cast<size_t>(state.range(0));
+    bench::SyntheticTree tree{1, 1, leaf_size};
+    GeometryIndex index = tree.build_index();
+    const GeometryLeaf* leaf = index.find("n0.values");
+    ReturnOptions options;
+    options.op = static_cast<ReduceOp>(state.range(1));
+
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        set_return_data(&data_block, *leaf, options);
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * leaf->count() * sizeof(double)));
+}
+BENCHMARK(BM_SetReturnDataReduce)->ArgNames({"leaf", "op"})->ArgsProduct({{1024, 65536}, {1, 2, 4, 6, 7}});
+
+void BM_SetReturnDataScalar(benchmark::State& state) {
+    bench::SyntheticTree tree{1, 1, 1};
+    GeometryIndex index = tree.build_index();
+    const GeometryLeaf* leaf = index.find("n0.count");
+
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        set_return_data(&data_block, *leaf, {});
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+}
+BENCHMARK(BM_SetReturnDataScalar);
+
+template <typename T> std::vector<T> make_values(size_t size) {
+    std::vector<T> values(size);
+    std::iota(values.begin(), values.end(), T{0});
+    return values;
+}
+
+template <typename T> void BM_SetReturnDataScalarType(benchmark::State& state) {
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        helpers::setReturnDataScalarType<T>(&data_block, T{1});
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+}
+BENCHMARK_TEMPLATE(BM_SetReturnDataScalarType, int);
+BENCHMARK_TEMPLATE(BM_SetReturnDataScalarType, double);
+
+template <typename T> void BM_SetReturnDataArrayOwned(benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        // The helper takes ownership of the buffer so each iteration allocates its own
+        auto data = static_cast<T*>(malloc(size * sizeof(T)));
+        helpers::setReturnDataArrayOwned<T>(&data_block, data, gsl::span<const size_t>{&size, 1});
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+}
+BENCHMARK_TEMPLATE(BM_SetReturnDataArrayOwned, double)->Arg(16)->Arg(1024)->Arg(65536);
+
+template <typename T> void BM_SetReturnDataArrayType(benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    std::vector<T> values = make_values<T>(size);
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        helpers::setReturnDataArrayType<T>(&data_block, gsl::span<const T>{values},
+                                           gsl::span<const size_t>{&size, 1});
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_SetReturnDataArrayType, int)->Arg(16)->Arg(1024)->Arg(65536);
+BENCHMARK_TEMPLATE(BM_SetReturnDataArrayType, double)->Arg(16)->Arg(1024)->Arg(65536);
+
+template <typename T> void BM_SetReturnDataArrayType_Vec(benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    std::vector<T> values = make_values<T>(size);
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        helpers::setReturnDataArrayType_Vec<T>(&data_block, values);
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_SetReturnDataArrayType_Vec, double)->Arg(16)->Arg(1024)->Arg(65536);
+
+template <typename T> void BM_SetReturnDataValArray(benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    std::vector<T> values = make_values<T>(size);
+    std::valarray<T> va_values(values.data(), values.size());
+    DATA_BLOCK data_block;
+    for (auto _ : state) {
+        helpers::setReturnDataValArray<T>(&data_block, va_values);
+        benchmark::DoNotOptimize(data_block.data);
+        release(data_block);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_SetReturnDataValArray, double)->Arg(16)->Arg(1024)->Arg(65536);
+
+} // namespace
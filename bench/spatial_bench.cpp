@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "bench/synthetic_tree.h"
+#include "geometry_spatial.h"
+
+namespace {
+
+using namespace geometry_map_reader;
+
+/**
+ * Build the element set and R-tree of a synthetic machine of the given number of probes (with probes / 4 coils
+ * and a wall of probes points)
+ */
+void BM_ElementSetBuild(benchmark::State& state) {
+    const auto probes = static_cast<size_t>(state.range(0));
+    bench::SyntheticMachine machine{probes, probes / 4, probes};
+    GeometryIndex index = machine.build_index();
+    for (auto _ : state) {
+        GeometryElementSet elements;
+        elements.add_tree("/synthetic", index);
+        elements.build();
+        benchmark::DoNotOptimize(elements);
+    }
+}
+BENCHMARK(BM_ElementSetBuild)->ArgName("probes")->Arg(256)->Arg(4096)->Arg(65536);
+
+/**
+ * Query random boxes of the given size (in mm) in a synthetic machine of the given number of probes
+ */
+void BM_RegionQuery(benchmark::State& state) {
+    const auto probes = static_cast<size_t>(state.range(0));
+    const double size = static_cast<double>(state.range(1)) / 1000;
+    bench::SyntheticMachine machine{probes, probes / 4, probes};
+    GeometryIndex index = machine.build_index();
+    GeometryElementSet elements;
+    elements.add_tree("/synthetic", index);
+    elements.build();
+
+    std::mt19937_64 random{42};
+    std::uniform_real_distribution<double> r{0.0, 2.0};
+    std::uniform_real_distribution<double> z{-2.0, 2.0};
+    size_t found = 0;
+    for (auto _ : state) {
+        double rmin = r(random);
+        double zmin = z(random);
+        std::vector<size_t> result = elements.query({rmin, rmin + size, zmin, zmin + size});
+        found += result.size();
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.counters["found"] = benchmark::Counter(static_cast<double>(found), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RegionQuery)->ArgNames({"probes", "box_mm"})->ArgsProduct({{256, 4096, 65536}, {10, 100, 1000}});
+
+/**
+ * Find the k nearest sensors to random points near the probe ellipse of a synthetic machine of the given number
+ * of probes, as when substituting a failed sensor. Points near the centre of the ellipse are a worst case: all
+ * the probes are at much the same distance.
+ */
+void BM_NearestQuery(benchmark::State& state) {
+    const auto probes = static_cast<size_t>(state.range(0));
+    const auto k = static_cast<size_t>(state.range(1));
+    bench::SyntheticMachine machine{probes, probes / 4, probes};
+    GeometryIndex index = machine.build_index();
+    GeometryElementSet elements;
+    elements.add_tree("/synthetic", index);
+    elements.build();
+
+    std::mt19937_64 random{42};
+    std::uniform_real_distribution<double> angle{0.0, 6.283185307179586};
+    std::uniform_real_distribution<double> scale{0.85, 0.95};
+    std::vector<std::pair<double, uint32_t>> found;
+    auto accept = [](uint32_t) { return true; };
+    for (auto _ : state) {
+        const double a = angle(random);
+        const double s = scale(random);
+        elements.nearest(1.0 + s * 0.6 * std::cos(a), s * 1.5 * std::sin(a), k, accept, found);
+        benchmark::DoNotOptimize(found.data());
+    }
+}
+BENCHMARK(BM_NearestQuery)->ArgNames({"probes", "k"})->ArgsProduct({{256, 4096, 65536}, {1, 8}});
+
+/**
+ * Test a batch of random points against the wall contour of the given number of points of a synthetic machine,
+ * with the signed distance when distance is 1
+ */
+void BM_InsideQuery(benchmark::State& state) {
+    const auto wall_points = static_cast<size_t>(state.range(0));
+    const bool with_distance = state.range(1) != 0;
+    bench::SyntheticMachine machine{0, 0, wall_points};
+    GeometryIndex index = machine.build_index();
+    GeometryElementSet elements;
+    elements.add_tree("/synthetic", index);
+    elements.build();
+    ContourSet contours;
+    for (size_t i = 0; i < elements.elements().size(); ++i) {
+        if (elements.is_contour(i)) {
+            contours.add(elements.elements()[i].r, elements.elements()[i].z);
+        }
+    }
+    contours.build();
+
+    constexpr size_t batch = 4096;
+    std::mt19937_64 random{42};
+    std::uniform_real_distribution<double> r{0.0, 2.0};
+    std::uniform_real_distribution<double> z{-2.0, 2.0};
+    std::vector<double> points_r(batch);
+    std::vector<double> points_z(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        points_r[i] = r(random);
+        points_z[i] = z(random);
+    }
+    std::vector<unsigned char> mask(batch);
+    std::vector<double> distance(batch);
+    for (auto _ : state) {
+        contours.inside(points_r.data(), points_z.data(), batch, mask.data());
+        if (with_distance) {
+            contours.signed_distance(points_r.data(), points_z.data(), batch, mask.data(), distance.data());
+        }
+        benchmark::DoNotOptimize(mask.data());
+        benchmark::DoNotOptimize(distance.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+}
+BENCHMARK(BM_InsideQuery)->ArgNames({"wall_points", "distance"})->ArgsProduct({{64, 1024, 16384}, {0, 1}});
+
+/**
+ * Rasterise the wall mask of a synthetic machine with a wall of 1024 points on a square grid of the given size,
+ * with the given number of threads
+ */
+void BM_WallMask(benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    const auto threads = static_cast<size_t>(state.range(1));
+    bench::SyntheticMachine machine{0, 0, 1024};
+    GeometryIndex index = machine.build_index();
+    GeometryElementSet elements;
+    elements.add_tree("/synthetic", index);
+    elements.build();
+    ContourSet contours;
+    for (size_t i = 0; i < elements.elements().size(); ++i) {
+        if (elements.is_contour(i)) {
+            contours.add(elements.elements()[i].r, elements.elements()[i].z);
+        }
+    }
+    contours.build();
+
+    const Box& bounds = contours.bounds();
+    const RasterGrid grid{bounds.rmin, bounds.rmax, bounds.zmin, bounds.zmax, size, size};
+    std::vector<unsigned char> mask(size * size);
+    std::vector<double> distance(size * size);
+    for (auto _ : state) {
+        rasterise(contours, grid, threads, mask.data(), distance.data());
+        benchmark::DoNotOptimize(mask.data());
+        benchmark::DoNotOptimize(distance.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * size * size));
+}
+BENCHMARK(BM_WallMask)->ArgNames({"grid", "threads"})->ArgsProduct({{64, 256}, {1, 4}})->UseRealTime();
+
+} // namespace
@@ -0,0 +1,114 @@
+#ifndef GEOMETRY_MAP_READER_SYNTHETIC_TREE_H
+#define GEOMETRY_MAP_READER_SYNTHETIC_TREE_H
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geometry_index.h"
+#include "geometry_source_memory.h"
+
+namespace geometry_map_reader::bench {
+
+/**
+ * A synthetic GEOM tree held in memory: fanout^depth structure nodes, each holding a rank 1 "values" array of
+ * leaf_size doubles, a rank 2 "grid" array of 2 x leaf_size doubles and a "count" int scalar. Keys are of the
+ * form n0.n3.n1.values. The tree is deterministic so results are comparable between runs.
+ */
+struct SyntheticTree {
+    MemoryTreeNode root{"data"};
+    std::vector<std::string> keys;
+
+    SyntheticTree(size_t depth, size_t fanout, size_t leaf_size) {
+        std::vector<double> values(leaf_size);
+        std::vector<double> grid(2 * leaf_size);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = 0.5 * static_cast<double>(i);
+        }
+        for (size_t i = 0; i < grid.size(); ++i) {
+            grid[i] = 0.25 * static_cast<double>(i);
+        }
+        add_nodes(root, "", depth, fanout, values, grid);
+    }
+
+    /**
+     * Build the index of the tree, as a geometry source does for a fetched tree
+     */
+    [[nodiscard]] GeometryIndex build_index() const { return GeometryIndex::build(MemoryTreeRef{root}); }
+
+  private:
+    void add_nodes(MemoryTreeNode& node, const std::string& prefix, size_t depth, size_t fanout,
+                   const std::vector<double>& values, const std::vector<double>& grid) {
+        if (depth == 0) {
+            node.add_array<double>("values", values, {values.size()});
+            node.add_array<double>("grid", grid, {2, values.size()});
+            node.add_scalar<int>("count", static_cast<int>(values.size()));
+            keys.push_back(prefix);
+            return;
+        }
+        for (size_t i = 0; i < fanout; ++i) {
+            std::string name = "n" + std::to_string(i);
+            add_nodes(node.add_child(name), prefix + (prefix.empty() ? "" : ".") + name, depth - 1, fanout, values,
+                      grid);
+        }
+    }
+};
+
+/**
+ * A synthetic machine cross-section in the layout the spatial queries read: probes (single r, z points) on an
+ * ellipse inside a wall polygon of wall_points points, and coils of 4 filaments (r, z, dr, dz) outside it.
+ * Elements are at probes.p<i>, coils.c<i> and wall.
+ */
+struct SyntheticMachine {
+    MemoryTreeNode root{"data"};
+
+    SyntheticMachine(size_t probes, size_t coils, size_t wall_points) {
+        constexpr double pi = 3.14159265358979323846;
+        auto ellipse = [&](size_t i, size_t count, double scale, double& r, double& z) {
+            double angle = 2 * pi * static_cast<double>(i) / static_cast<double>(count);
+            r = 1.0 + scale * 0.6 * std::cos(angle);
+            z = scale * 1.5 * std::sin(angle);
+        };
+
+        MemoryTreeNode& probe_nodes = root.add_child("probes");
+        for (size_t i = 0; i < probes; ++i) {
+            double r;
+            double z;
+            ellipse(i, probes, 0.9, r, z);
+            MemoryTreeNode& probe = probe_nodes.add_child("p" + std::to_string(i));
+            probe.add_scalar<double>("r", r);
+            probe.add_scalar<double>("z", z);
+        }
+
+        MemoryTreeNode& coil_nodes = root.add_child("coils");
+        for (size_t i = 0; i < coils; ++i) {
+            double r;
+            double z;
+            ellipse(i, coils, 1.3, r, z);
+            std::vector<double> rs = {r - 0.01, r + 0.01, r - 0.01, r + 0.01};
+            std::vector<double> zs = {z - 0.01, z - 0.01, z + 0.01, z + 0.01};
+            std::vector<double> sizes(4, 0.02);
+            MemoryTreeNode& coil = coil_nodes.add_child("c" + std::to_string(i));
+            coil.add_array<double>("r", rs, {4});
+            coil.add_array<double>("z", zs, {4});
+            coil.add_array<double>("dr", sizes, {4});
+            coil.add_array<double>("dz", sizes, {4});
+        }
+
+        std::vector<double> wall_r(wall_points + 1);
+        std::vector<double> wall_z(wall_points + 1);
+        for (size_t i = 0; i <= wall_points; ++i) {
+            ellipse(i % wall_points, wall_points, 1.0, wall_r[i], wall_z[i]);
+        }
+        MemoryTreeNode& wall = root.add_child("wall");
+        wall.add_array<double>("r", wall_r, {wall_r.size()});
+        wall.add_array<double>("z", wall_z, {wall_z.size()});
+    }
+
+    [[nodiscard]] GeometryIndex build_index() const { return GeometryIndex::build(MemoryTreeRef{root}); }
+};
+
+} // namespace geometry_map_reader::bench
+
+#endif // GEOMETRY_MAP_READER_SYNTHETIC_TREE_H
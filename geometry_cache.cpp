@@ -0,0 +1,147 @@
+#include "geometry_cache.h"
+
+#include <boost/functional/hash.hpp>
+
+namespace geometry_map_reader {
+
+size_t GeometryCacheKeyHash::operator()(const GeometryCacheKey& key) const noexcept {
+    size_t seed = 0;
+    boost::hash_combine(seed, key.host);
+    boost::hash_combine(seed, key.port);
+    boost::hash_combine(seed, key.source);
+    boost::hash_combine(seed, key.signal);
+    boost::hash_combine(seed, key.config);
+    boost::hash_combine(seed, static_cast<int>(key.backend));
+    return seed;
+}
+
+const GeometryCacheEntry* GeometryTreeCache::find(const GeometryCacheKey& key) {
+    auto found = entries_.find(key);
+    if (found == entries_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return &found->second->second;
+}
+
+const GeometryCacheEntry* GeometryTreeCache::insert(const GeometryCacheKey& key, const GeometryCacheEntry& entry) {
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        bytes_ -= found->second->second.bytes;
+        lru_.erase(found->second);
+        entries_.erase(found);
+    }
+    if (entry.bytes > byte_budget_) {
+        return nullptr;
+    }
+
+    evict(byte_budget_ - entry.bytes);
+    lru_.emplace_front(key, entry);
+    entries_.emplace(key, lru_.begin());
+    bytes_ += entry.bytes;
+
+    return &lru_.front().second;
+}
+
+bool GeometryTreeCache::erase(const GeometryCacheKey& key) {
+    auto found = entries_.find(key);
+    if (found == entries_.end()) {
+        return false;
+    }
+    bytes_ -= found->second->second.bytes;
+    lru_.erase(found->second);
+    entries_.erase(found);
+    return true;
+}
+
+void GeometryTreeCache::clear() {
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+void GeometryTreeCache::set_byte_budget(size_t byte_budget) {
+    byte_budget_ = byte_budget;
+    evict(byte_budget_);
+}
+
+void GeometryTreeCache::evict(size_t byte_budget) {
+    while (bytes_ > byte_budget && !lru_.empty()) {
+        bytes_ -= lru_.back().second.bytes;
+        entries_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+size_t NegativeCacheKeyHash::operator()(const NegativeCacheKey& key) const noexcept {
+    size_t seed = 0;
+    boost::hash_combine(seed, key.host);
+    boost::hash_combine(seed, key.port);
+    boost::hash_combine(seed, key.source);
+    boost::hash_combine(seed, key.config);
+    boost::hash_combine(seed, key.signal);
+    boost::hash_combine(seed, key.key);
+    boost::hash_combine(seed, static_cast<int>(key.backend));
+    return seed;
+}
+
+bool NegativeCache::contains(const NegativeCacheKey& key) {
+    auto found = entries_.find(key);
+    if (found == entries_.end()) {
+        return false;
+    }
+    if (found->second->second <= clock::now()) {
+        order_.erase(found->second);
+        entries_.erase(found);
+        return false;
+    }
+    return true;
+}
+
+void NegativeCache::insert(const NegativeCacheKey& key) {
+    if (max_entries_ == 0) {
+        return;
+    }
+
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        order_.erase(found->second);
+        entries_.erase(found);
+    }
+
+    evict(max_entries_ - 1);
+    order_.emplace_front(key, clock::now() + ttl_);
+    entries_.emplace(key, order_.begin());
+}
+
+void NegativeCache::erase_signal(const NegativeCacheKey& key) {
+    for (auto entry = order_.begin(); entry != order_.end();) {
+        const NegativeCacheKey& failed = entry->first;
+        if (failed.port == key.port && failed.source == key.source && failed.config == key.config &&
+            failed.backend == key.backend && failed.host == key.host && failed.signal == key.signal) {
+            entries_.erase(failed);
+            entry = order_.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+void NegativeCache::clear() {
+    entries_.clear();
+    order_.clear();
+}
+
+void NegativeCache::set_max_entries(size_t max_entries) {
+    max_entries_ = max_entries;
+    evict(max_entries_);
+}
+
+void NegativeCache::evict(size_t max_entries) {
+    while (order_.size() > max_entries) {
+        entries_.erase(order_.back().first);
+        order_.pop_back();
+    }
+}
+
+} // namespace geometry_map_reader
@@ -0,0 +1,167 @@
+#ifndef GEOMETRY_MAP_READER_CACHE_H
+#define GEOMETRY_MAP_READER_CACHE_H
+
+#include "geometry_index.h"
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace geometry_map_reader {
+
+/**
+ * The geometry sources a tree can be fetched from
+ */
+enum class GeometryBackend : int {
+    Uda,  // GEOM::get through a GEOM UDA server
+    File, // geometry files read directly
+};
+
+/**
+ * Identifies one GEOM::get response: the backend and endpoint it was fetched from (empty host and zero port for
+ * the file backend), the data source and the (lowercased) signal and configuration requested.
+ */
+struct GeometryCacheKey {
+    std::string host;
+    int port = 0;
+    int source = 0;
+    std::string signal;
+    int config = 1;
+    GeometryBackend backend = GeometryBackend::Uda;
+
+    bool operator==(const GeometryCacheKey& other) const {
+        return port == other.port && source == other.source && config == other.config && backend == other.backend &&
+               host == other.host && signal == other.signal;
+    }
+};
+
+struct GeometryCacheKeyHash {
+    size_t operator()(const GeometryCacheKey& key) const noexcept;
+};
+
+/**
+ * The leaf index of a fetched geometry tree and the storage keeping its leaf data alive, eg. a copy of the tree in
+ * memory or a mapped store file. The data is freed with the last entry referencing its storage.
+ */
+struct GeometryCacheEntry {
+    std::shared_ptr<const GeometryIndex> index;
+    std::shared_ptr<const void> storage;
+    size_t bytes = 0;
+};
+
+/**
+ * Bounded LRU cache of fetched GEOM trees. The size of each entry is estimated from the atomic data
+ * held in its tree and the least recently used entries are evicted once the byte budget is exceeded.
+ */
+class GeometryTreeCache {
+  public:
+    static constexpr size_t default_byte_budget = 256 * 1024 * 1024;
+
+    explicit GeometryTreeCache(size_t byte_budget = default_byte_budget) : byte_budget_{byte_budget} {}
+
+    /**
+     * Look up a cached tree, marking it as most recently used.
+     * @return the cached entry or nullptr if the key is not cached
+     */
+    const GeometryCacheEntry* find(const GeometryCacheKey& key);
+
+    /**
+     * Insert (or replace) a tree. Entries larger than the whole budget are not cached.
+     * @return the cached entry or nullptr if the entry was not retained
+     */
+    const GeometryCacheEntry* insert(const GeometryCacheKey& key, const GeometryCacheEntry& entry);
+
+    /**
+     * Drop a tree from the cache
+     * @return true if the key was cached
+     */
+    bool erase(const GeometryCacheKey& key);
+
+    void clear();
+
+    void set_byte_budget(size_t byte_budget);
+    [[nodiscard]] size_t byte_budget() const { return byte_budget_; }
+    [[nodiscard]] size_t bytes() const { return bytes_; }
+    [[nodiscard]] size_t size() const { return lru_.size(); }
+
+  private:
+    using LruList = std::list<std::pair<GeometryCacheKey, GeometryCacheEntry>>;
+
+    void evict(size_t byte_budget);
+
+    LruList lru_;
+    std::unordered_map<GeometryCacheKey, LruList::iterator, GeometryCacheKeyHash> entries_;
+    size_t byte_budget_;
+    size_t bytes_ = 0;
+};
+
+/**
+ * Identifies a failed lookup: a signal that could not be fetched (empty key) or a key that could not be
+ * resolved in the signal's tree, from one backend and endpoint (empty host and zero port for the file backend).
+ */
+struct NegativeCacheKey {
+    std::string host;
+    int port = 0;
+    int source = 0;
+    int config = 1;
+    std::string signal;
+    std::string key;
+    GeometryBackend backend = GeometryBackend::Uda;
+
+    bool operator==(const NegativeCacheKey& other) const {
+        return port == other.port && source == other.source && config == other.config && host == other.host &&
+               signal == other.signal && key == other.key && backend == other.backend;
+    }
+};
+
+struct NegativeCacheKeyHash {
+    size_t operator()(const NegativeCacheKey& key) const noexcept;
+};
+
+/**
+ * Bounded cache of failed lookups, each remembered for a fixed time to live. Once the entry limit is reached the
+ * oldest failures are forgotten first.
+ */
+class NegativeCache {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr size_t default_max_entries = 10000;
+    static constexpr std::chrono::seconds default_ttl{300};
+
+    /**
+     * @return true if the lookup failed within the time to live
+     */
+    bool contains(const NegativeCacheKey& key);
+
+    void insert(const NegativeCacheKey& key);
+
+    /**
+     * Forget every failed lookup of the signal of key, whatever its key
+     */
+    void erase_signal(const NegativeCacheKey& key);
+
+    void clear();
+
+    void set_max_entries(size_t max_entries);
+    void set_ttl(std::chrono::seconds ttl) { ttl_ = ttl; }
+    [[nodiscard]] size_t size() const { return order_.size(); }
+
+  private:
+    using OrderList = std::list<std::pair<NegativeCacheKey, clock::time_point>>;
+
+    void evict(size_t max_entries);
+
+    OrderList order_;
+    std::unordered_map<NegativeCacheKey, OrderList::iterator, NegativeCacheKeyHash> entries_;
+    size_t max_entries_ = default_max_entries;
+    std::chrono::seconds ttl_ = default_ttl;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_CACHE_H
@@ -0,0 +1,48 @@
+#include "geometry_client_pool.h"
+
+#include <fmt/format.h>
+
+namespace geometry_map_reader {
+
+uda::Client& ClientPool::acquire(const std::string& host, int port) {
+    std::string name = fmt::format("{}:{}", host, port);
+
+    Endpoint& endpoint = endpoints_[name];
+    if (!endpoint.client) {
+        endpoint.client = std::make_unique<uda::Client>();
+    }
+
+    if (name != current_) {
+        uda::Client::setServerHostName(host);
+        uda::Client::setServerPort(port);
+        current_ = std::move(name);
+    }
+
+    ++endpoint.requests;
+    endpoint.last_used = std::chrono::steady_clock::now();
+    return *endpoint.client;
+}
+
+const uda::Client* ClientPool::find(const std::string& host, int port) const {
+    auto found = endpoints_.find(fmt::format("{}:{}", host, port));
+    return found != endpoints_.end() ? found->second.client.get() : nullptr;
+}
+
+void ClientPool::clear() {
+    endpoints_.clear();
+    current_.clear();
+}
+
+std::vector<EndpointStats> ClientPool::stats() const {
+    auto now = std::chrono::steady_clock::now();
+
+    std::vector<EndpointStats> stats;
+    stats.reserve(endpoints_.size());
+    for (const auto& [name, endpoint] : endpoints_) {
+        std::chrono::duration<double> idle = now - endpoint.last_used;
+        stats.push_back({name, endpoint.requests, idle.count()});
+    }
+    return stats;
+}
+
+} // namespace geometry_map_reader
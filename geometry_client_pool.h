@@ -0,0 +1,62 @@
+#ifndef GEOMETRY_MAP_READER_CLIENT_POOL_H
+#define GEOMETRY_MAP_READER_CLIENT_POOL_H
+
+#include <c++/UDA.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace geometry_map_reader {
+
+/**
+ * Usage of one pooled endpoint
+ */
+struct EndpointStats {
+    std::string endpoint;
+    size_t requests = 0;
+    double idle_seconds = 0.0;
+};
+
+/**
+ * Pool of uda::Client connections keyed by host:port, created lazily on first use and kept alive until cleared.
+ *
+ * The UDA client library keeps a socket per server it has connected to, but the selected server is process
+ * global state. The pool only re-selects the server when the requested endpoint differs from the last one used.
+ * Requests are made with uda::Client::get_batch, whose results are owned by the returned uda::ResultList rather
+ * than the client, so a pooled client does not accumulate the results of its requests.
+ */
+class ClientPool {
+  public:
+    /**
+     * @return the client for the endpoint, selected as the current UDA server
+     */
+    uda::Client& acquire(const std::string& host, int port);
+
+    /**
+     * @return the endpoint's client, or nullptr if it has not been acquired since the pool was last cleared
+     */
+    [[nodiscard]] const uda::Client* find(const std::string& host, int port) const;
+
+    void clear();
+
+    [[nodiscard]] size_t size() const { return endpoints_.size(); }
+    [[nodiscard]] std::vector<EndpointStats> stats() const;
+
+  private:
+    struct Endpoint {
+        std::unique_ptr<uda::Client> client;
+        size_t requests = 0;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    std::unordered_map<std::string, Endpoint> endpoints_;
+    std::string current_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_CLIENT_POOL_H
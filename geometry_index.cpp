@@ -0,0 +1,93 @@
+#include "geometry_index.h"
+
+#include <utility>
+
+namespace geometry_map_reader {
+
+UDA_TYPE atomic_uda_type(std::string_view type) {
+    static constexpr std::pair<std::string_view, UDA_TYPE> types[] = {
+        {"char", UDA_TYPE_CHAR},
+        {"unsigned char", UDA_TYPE_UNSIGNED_CHAR},
+        {"short", UDA_TYPE_SHORT},
+        {"unsigned short", UDA_TYPE_UNSIGNED_SHORT},
+        {"int", UDA_TYPE_INT},
+        {"unsigned int", UDA_TYPE_UNSIGNED_INT},
+        {"long", UDA_TYPE_LONG},
+        {"unsigned long", UDA_TYPE_UNSIGNED_LONG},
+        {"long long", UDA_TYPE_LONG64},
+        {"unsigned long long", UDA_TYPE_UNSIGNED_LONG64},
+        {"float", UDA_TYPE_FLOAT},
+        {"double", UDA_TYPE_DOUBLE},
+        {"STRING", UDA_TYPE_STRING},
+    };
+    for (const auto& [name, uda_type] : types) {
+        if (name == type) {
+            return uda_type;
+        }
+    }
+    return UDA_TYPE_UNKNOWN;
+}
+
+size_t uda_type_size(UDA_TYPE type) {
+    switch (type) {
+        case UDA_TYPE_CHAR:
+        case UDA_TYPE_UNSIGNED_CHAR:
+            return 1;
+        case UDA_TYPE_SHORT:
+        case UDA_TYPE_UNSIGNED_SHORT:
+            return 2;
+        case UDA_TYPE_INT:
+        case UDA_TYPE_UNSIGNED_INT:
+        case UDA_TYPE_FLOAT:
+            return 4;
+        case UDA_TYPE_LONG:
+        case UDA_TYPE_UNSIGNED_LONG:
+            return sizeof(long);
+        default:
+            return 8;
+    }
+}
+
+bool key_matches(std::string_view pattern, std::string_view key) {
+    while (!pattern.empty()) {
+        if (pattern.substr(0, 2) == "**") {
+            pattern.remove_prefix(2);
+            for (size_t i = 0; i <= key.size(); ++i) {
+                if (key_matches(pattern, key.substr(i))) {
+                    return true;
+                }
+            }
+            return false;
+        } else if (pattern.front() == '*') {
+            pattern.remove_prefix(1);
+            for (size_t i = 0; i <= key.size(); ++i) {
+                if (key_matches(pattern, key.substr(i))) {
+                    return true;
+                }
+                if (i < key.size() && key[i] == '.') {
+                    break;
+                }
+            }
+            return false;
+        } else if (key.empty() || (pattern.front() == '?' ? key.front() == '.' : pattern.front() != key.front())) {
+            return false;
+        }
+        pattern.remove_prefix(1);
+        key.remove_prefix(1);
+    }
+    return key.empty();
+}
+
+bool GeometryIndex::add_leaf(std::string key, GeometryLeaf leaf) {
+    if (leaves_.count(key)) {
+        return false;
+    }
+
+    bytes_ += leaf.count() * uda_type_size(leaf.type);
+
+    const std::string& stored = keys_.emplace_back(std::move(key));
+    leaves_.emplace(stored, std::move(leaf));
+    return true;
+}
+
+} // namespace geometry_map_reader
@@ -0,0 +1,160 @@
+#ifndef GEOMETRY_MAP_READER_INDEX_H
+#define GEOMETRY_MAP_READER_INDEX_H
+
+#include <clientserver/udaTypes.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace geometry_map_reader {
+
+/**
+ * Match a dotted key against a glob pattern. '*' matches any run of characters within one path element,
+ * '**' matches across path elements and '?' matches any single character other than '.'.
+ * eg. *.r matches coil.r, coils.*.turns matches coils.p1.turns and **.r matches coils.p1.geometry.r
+ */
+bool key_matches(std::string_view pattern, std::string_view key);
+
+/**
+ * @return true if the key contains glob wildcards
+ */
+inline bool is_key_pattern(std::string_view key) {
+    return key.find_first_of("*?") != std::string_view::npos;
+}
+
+/**
+ * A resolved atomic leaf of a geometry tree: everything needed to return it without touching the tree again.
+ */
+struct GeometryLeaf {
+    UDA_TYPE type = UDA_TYPE_UNKNOWN;
+    size_t rank = 0;
+    std::vector<size_t> shape;
+    const void* data = nullptr;
+
+    /**
+     * @return number of elements in the leaf, the product of its shape
+     */
+    [[nodiscard]] size_t count() const {
+        size_t count = 1;
+        for (size_t dim : shape) {
+            count *= dim;
+        }
+        return count;
+    }
+};
+
+/**
+ * Flat index from full dotted key (eg. coil.geometry.r) to resolved leaf, built once per fetched tree.
+ */
+class GeometryIndex {
+  public:
+    GeometryIndex() = default;
+    GeometryIndex(const GeometryIndex&) = delete;
+    GeometryIndex& operator=(const GeometryIndex&) = delete;
+    GeometryIndex(GeometryIndex&&) = default;
+    GeometryIndex& operator=(GeometryIndex&&) = default;
+
+    /**
+     * Walk the tree and index every atomic leaf by its dotted path relative to root. Where sibling nodes share
+     * a name the first one wins, matching a depth-first name search.
+     *
+     * Node is a cheap handle to a tree node of a geometry source (see geometry_source.h) providing
+     *   std::string name() const
+     *   std::vector<Node> children() const
+     *   void for_each_atomic(F&& f) const, calling f(std::string_view name, const GeometryLeaf& leaf)
+     */
+    template <typename Node> static GeometryIndex build(const Node& root) {
+        GeometryIndex index;
+
+        // Iterative depth-first walk; children are pushed in reverse so they are visited in tree order
+        std::vector<std::pair<Node, std::string>> stack;
+        stack.emplace_back(root, "");
+        while (!stack.empty()) {
+            auto [node, path] = std::move(stack.back());
+            stack.pop_back();
+
+            // Fixed overhead for the node itself so that trees of empty structures still have a cost
+            index.bytes_ += sizeof(Node) + node.name().size();
+
+            node.for_each_atomic([&](std::string_view name, const GeometryLeaf& leaf) {
+                std::string key{path};
+                key.append(path.empty() ? "" : ".").append(name);
+                index.add_leaf(std::move(key), leaf);
+            });
+
+            std::vector<Node> children = node.children();
+            for (auto child = children.rbegin(); child != children.rend(); ++child) {
+                std::string name = child->name();
+                stack.emplace_back(std::move(*child), path.empty() ? name : path + "." + name);
+            }
+        }
+        return index;
+    }
+
+    /**
+     * Add a leaf under its full dotted key. The first leaf added for a key wins.
+     * @return true if the leaf was added
+     */
+    bool add_leaf(std::string key, GeometryLeaf leaf);
+
+    /**
+     * @return the leaf for the full dotted key or nullptr if no such leaf exists
+     */
+    [[nodiscard]] const GeometryLeaf* find(std::string_view key) const {
+        auto found = leaves_.find(key);
+        return found != leaves_.end() ? &found->second : nullptr;
+    }
+
+    /**
+     * Call f(key, leaf) for every leaf whose key matches the glob pattern, in tree order.
+     * @see key_matches
+     */
+    template <typename F> void for_each_match(std::string_view pattern, F&& f) const {
+        for (const std::string& key : keys_) {
+            if (key_matches(pattern, key)) {
+                f(std::string_view{key}, leaves_.at(key));
+            }
+        }
+    }
+
+    /**
+     * Call f(key, leaf) for every leaf, in tree order.
+     */
+    template <typename F> void for_each_leaf(F&& f) const {
+        for (const std::string& key : keys_) {
+            f(std::string_view{key}, leaves_.at(key));
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return leaves_.size(); }
+
+    /**
+     * @return estimated number of bytes of atomic data referenced by the index
+     */
+    [[nodiscard]] size_t bytes() const { return bytes_; }
+
+  private:
+    // Storage for the keys viewed by leaves_; deque elements never move once inserted
+    std::deque<std::string> keys_;
+    std::unordered_map<std::string_view, GeometryLeaf> leaves_;
+    size_t bytes_ = 0;
+};
+
+/**
+ * @return the UDA type of a tree atomic type name, eg. "double", or UDA_TYPE_UNKNOWN if not supported
+ */
+UDA_TYPE atomic_uda_type(std::string_view type);
+
+/**
+ * @return size in bytes of one element of a UDA type (the pointer size for strings)
+ */
+size_t uda_type_size(UDA_TYPE type);
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_INDEX_H
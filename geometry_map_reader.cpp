@@ -1,6 +1,5 @@
 #include "geometry_map_reader.h"
 
-#include <boost/algorithm/string.hpp>
 #include <c++/UDA.hpp>
 #include <clientserver/initStructs.h>
 #include <clientserver/stringUtils.h>
@@ -10,145 +9,299 @@
 #include <plugins/pluginStructs.h>
 #include <plugins/udaPlugin.h>
 
+#include "geometry_plugin.h"
+#include "geometry_return.h"
 #include "utils/uda_plugin_helpers.hpp"
-#include <deque>
+#include "utils/uda_structure_helpers.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-class GeometryMapReaderPlugin {
-  public:
-    void init(IDAM_PLUGIN_INTERFACE* plugin_interface) {
-        REQUEST_DATA* request = plugin_interface->request_data;
-        if (!init_ || STR_IEQUALS(request->function, "init") || STR_IEQUALS(request->function, "initialise")) {
-            reset(plugin_interface);
-            // Initialise plugin
-            init_ = true;
+/**
+ * Initialise the plugin from its environment on first use, or again on an explicit init request
+ */
+void GeometryMapReaderPlugin::init(IDAM_PLUGIN_INTERFACE* plugin_interface) {
+    REQUEST_DATA* request = plugin_interface->request_data;
+    if (!init_ || STR_IEQUALS(request->function, "init") || STR_IEQUALS(request->function, "initialise")) {
+        reset(plugin_interface);
+        // Initialise plugin
+        const char* cache_bytes = std::getenv("GEOMETRY_CACHE_BYTES");
+        if (cache_bytes != nullptr) {
+            cache_.set_byte_budget(std::strtoull(cache_bytes, nullptr, 10));
         }
-    }
-    void reset(IDAM_PLUGIN_INTERFACE* plugin_interface) {
-        if (!init_) {
-            // Not previously initialised: Nothing to do!
-            return;
+        const char* negative_entries = std::getenv("GEOMETRY_NEGATIVE_CACHE_ENTRIES");
+        if (negative_entries != nullptr) {
+            negative_cache_.set_max_entries(std::strtoull(negative_entries, nullptr, 10));
+        }
+        const char* negative_ttl = std::getenv("GEOMETRY_NEGATIVE_CACHE_TTL");
+        if (negative_ttl != nullptr) {
+            negative_cache_.set_ttl(std::chrono::seconds{std::strtoll(negative_ttl, nullptr, 10)});
+        }
+        const char* store_dir = std::getenv("GEOMETRY_STORE_DIR");
+        if (store_dir != nullptr && store_dir[0] != '\0') {
+            const char* store_ttl = std::getenv("GEOMETRY_STORE_TTL");
+            store_.emplace(store_dir,
+                           std::chrono::seconds{store_ttl != nullptr ? std::strtoll(store_ttl, nullptr, 10) : 0});
+            store_->collect();
+        }
+        const char* file_dir = std::getenv("GEOMETRY_FILE_DIR");
+        if (file_dir != nullptr && file_dir[0] != '\0') {
+            file_source_.emplace(stats_, file_dir);
+        }
+        const char* backend = std::getenv("GEOMETRY_BACKEND");
+        if (backend != nullptr && STR_IEQUALS(backend, "file")) {
+            default_backend_ = geometry_map_reader::GeometryBackend::File;
         }
-        // Free Heap & reset counters
-        init_ = false;
+        const char* element_signals = std::getenv("GEOMETRY_ELEMENT_SIGNALS");
+        element_signals_ = element_signals != nullptr ? element_signals : "";
+        const char* raster_threads = std::getenv("GEOMETRY_RASTER_THREADS");
+        raster_threads_ = raster_threads != nullptr ? std::strtoull(raster_threads, nullptr, 10) : 0;
+        if (raster_threads_ == 0) {
+            raster_threads_ = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        const char* trace_events = std::getenv("GEOMETRY_TRACE_EVENTS");
+        size_t trace_capacity = trace_events != nullptr ? std::strtoull(trace_events, nullptr, 10) : 0;
+        if (trace_capacity > 0) {
+            trace_ = std::make_unique<geometry_map_reader::TraceBuffer>(trace_capacity);
+            stats_.set_trace(trace_.get());
+        }
+        init_ = true;
     }
-
-    int help(IDAM_PLUGIN_INTERFACE* plugin_interface);
-    int version(IDAM_PLUGIN_INTERFACE* plugin_interface);
-    int build_date(IDAM_PLUGIN_INTERFACE* plugin_interface);
-    int default_method(IDAM_PLUGIN_INTERFACE* plugin_interface);
-    int max_interface_version(IDAM_PLUGIN_INTERFACE* plugin_interface);
-    int get(IDAM_PLUGIN_INTERFACE* plugin_interface);
-
-  private:
-    bool init_ = false;
-};
-
-std::deque<std::string> split_request(std::string_view var) {
-    std::deque<std::string> split_vec;
-    boost::split(split_vec, var, boost::is_any_of("."));
-    return split_vec;
 }
 
-int tree_check(uda::TreeNode& temp_tree) {
-
-    if (!temp_tree.numChildren()) {
-        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::tree_check: No children found\n");
-        return 1;
-    }
-    if (temp_tree.child(0).name() != "data") {
-        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::tree_check: No child named data\n");
-        return 1;
+/**
+ * Release all cached trees, connections and configuration
+ */
+void GeometryMapReaderPlugin::reset(IDAM_PLUGIN_INTERFACE* plugin_interface) {
+    if (!init_) {
+        // Not previously initialised: Nothing to do!
+        return;
     }
-    return 0;
-};
+    // Free Heap & reset counters
+    cache_.clear();
+    negative_cache_.clear();
+    uda_source_.clear();
+    file_source_.reset();
+    std::fill(std::begin(source_overrides_), std::end(source_overrides_), nullptr);
+    default_backend_ = geometry_map_reader::GeometryBackend::Uda;
+    store_.reset();
+    stats_.reset();
+    stats_.set_trace(nullptr);
+    trace_.reset();
+    element_signals_.clear();
+    element_sets_.clear();
+    contour_sets_.clear();
+    raster_threads_ = 1;
+    wall_masks_.clear();
+    init_ = false;
+}
 
-std::vector<std::string> get_treenode_child_names(uda::TreeNode& tree) {
-    std::vector<std::string> temp_name_vec;
-    for (auto& child : tree.children()) {
-        temp_name_vec.push_back(child.name());
+void GeometryMapReaderPlugin::set_source(geometry_map_reader::GeometryBackend backend,
+                                         geometry_map_reader::GeometrySource* source) {
+    source_overrides_[static_cast<int>(backend)] = source;
+}
+
+/**
+ * Call f with each signal of a ';' separated list, lowercased
+ */
+template <typename F> void for_each_signal(std::string_view signals, F&& f) {
+    while (!signals.empty()) {
+        auto end = std::min(signals.find(';'), signals.size());
+        std::string signal_str{signals.substr(0, end)};
+        signals.remove_prefix(std::min(end + 1, signals.size()));
+        if (!signal_str.empty()) {
+            std::transform(signal_str.begin(), signal_str.end(), signal_str.begin(), ::tolower);
+            f(std::move(signal_str));
+        }
     }
-    return temp_name_vec;
 }
 
-int tree_node_traversal(uda::TreeNode& tree, std::deque<std::string>& vec_split) {
+/**
+ * Return several leaves of one tree as a single structure with a member per leaf. Keys are ';' separated and
+ * may be glob patterns, eg. key=a.r;a.z or key=coils.*.turns (see geometry_map_reader::key_matches), each
+ * optionally sliced, eg. key=a.r[0:10];a.z[0:10] (see geometry_map_reader::split_key_slices). With op set each
+ * member holds the reduction of its leaf rather than the leaf values. Members are named after the resolved key
+ * with '.' replaced by '_' (eg. a_r) and the resolved keys, with their slices, are also returned, ';' separated
+ * and in member order, in the resolved_paths member. A leaf matched again with the same slice is returned once;
+ * keys that would share a member, eg. a.r[0:10];a.r[10:20] or a.b_c;a_b.c, fail the request.
+ * @param key_not_found set if the request failed because a key or pattern resolved to no leaf, rather than
+ * because of its slices or op
+ */
+int set_return_batch(IDAM_PLUGIN_INTERFACE* interface, const geometry_map_reader::GeometryIndex& index,
+                     std::string_view keys, const geometry_map_reader::ReturnOptions& options, bool& key_not_found) {
 
-    if (vec_split.size() <= 1 or !tree.numChildren()) {
-        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::tree_node_traversal: TreeNode at bottom level\n");
-        return 0;
-    }
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryBatch"};
+    std::unordered_set<std::string> added;
+    std::string resolved_paths;
+    geometry_map_reader::ReturnOptions key_options = options;
+    std::string_view slice_suffix;
+    int err = 0;
+    key_not_found = false;
 
-    std::vector<std::string> children{get_treenode_child_names(tree)};
-    auto result = std::find(children.begin(), children.end(), vec_split.front());
-    if (result != children.end()) {
-        tree = tree.child(std::distance(children.begin(), result));
-        vec_split.pop_front();
-        tree_node_traversal(tree, vec_split);
-    } else {
-        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::tree_node_traversal: Child name not found\n");
-        return 1;
-    }
-    return 0;
-};
+    auto add_leaf = [&](std::string_view key, const geometry_map_reader::GeometryLeaf& leaf) {
+        if (err || !added.insert(std::string{key}.append(slice_suffix)).second) {
+            return;
+        }
+        resolved_paths.append(resolved_paths.empty() ? "" : ";").append(key).append(slice_suffix);
+        if ((leaf.type == UDA_TYPE_STRING || leaf.rank == 0) && !key_options.slices.empty()) {
+            UDA_LOG(UDA_LOG_DEBUG,
+                    "\nimas_json_plugin::plugin_helpers::set_return_batch: Strings and scalars can not be sliced\n");
+            err = 1;
+            return;
+        }
+        if (key_options.op != geometry_map_reader::ReduceOp::None) {
+            err = geometry_map_reader::reduce_leaf(leaf, key_options, [&](auto values) {
+                using R = std::remove_const_t<typename decltype(values)::element_type>;
+                if (values.size() == 1) {
+                    builder.addScalar<R>(key, values[0], key);
+                } else {
+                    const size_t shape[] = {values.size()};
+                    builder.addArray<R>(key, values, gsl::span<const size_t>{shape}, key);
+                }
+            });
+            return;
+        }
+        if (leaf.type == UDA_TYPE_STRING) {
+            builder.addString(key, leaf.data != nullptr ? static_cast<const char*>(leaf.data) : "", key);
+            return;
+        }
+        int copy_err = 0;
+        err = geometry_map_reader::visit_leaf_as(leaf, key_options, [&](auto* data, auto* as) {
+            using T = std::remove_const_t<std::remove_pointer_t<decltype(data)>>;
+            using U = std::remove_pointer_t<decltype(as)>;
+            imas_json_plugin::array_kernels::ConversionLoss loss;
+            auto* report = options.report_loss && !std::is_same_v<T, U> ? &loss : nullptr;
+            auto description = [&] {
+                if (report == nullptr) {
+                    return std::string{key};
+                }
+                return fmt::format("{} ({})", key,
+                                   geometry_map_reader::describe_conversion(loss, leaf.type, options.dtype));
+            };
 
-int set_return_data(IDAM_PLUGIN_INTERFACE* interface, uda::TreeNode& final_tree, const std::string& final_var) {
+            if (leaf.rank > 0) {
+                std::vector<size_t> shape;
+                U* out = nullptr;
+                copy_err = geometry_map_reader::copy_leaf<U>(data, leaf, key_options, out, shape, report);
+                if (copy_err) {
+                    return;
+                }
+                if (shape.empty()) {
+                    builder.addScalar<U>(key, *out, description());
+                    free(out);
+                } else {
+                    size_t count = std::accumulate(shape.begin(), shape.end(), size_t{1}, std::multiplies<>{});
+                    builder.addOwnedArray<U>(key, out, count, gsl::span<const size_t>{shape}, description());
+                }
+            } else {
+                U value;
+                imas_json_plugin::array_kernels::convert(data, 1, &value, report);
+                builder.addScalar<U>(key, value, description());
+            }
+        });
+        err = err ? err : copy_err;
+    };
 
-    std::vector<std::string> anames = final_tree.atomicNames();
-    std::vector<std::string> atypes = final_tree.atomicTypes();
-    std::vector<bool> apoint = final_tree.atomicPointers();
-    std::vector<size_t> arank = final_tree.atomicRank();
-    std::vector<std::vector<size_t>> ashape = final_tree.atomicShape();
+    while (!keys.empty()) {
+        auto end = std::min(keys.find(';'), keys.size());
+        auto key = keys.substr(0, end);
+        keys.remove_prefix(std::min(end + 1, keys.size()));
+        if (key.empty()) {
+            continue;
+        }
 
-    auto result = std::find(anames.begin(), anames.end(), final_var);
-    if (result == anames.end()) {
-        return 1;
-    }
+        std::string_view leaf_key;
+        if (geometry_map_reader::split_key_slices(key, leaf_key, key_options.slices)) {
+            return 1;
+        }
+        slice_suffix = key.substr(leaf_key.size());
 
-    long idx{std::distance(anames.begin(), result)};
-
-    // Would be good to use apoint here but seems to be false every time
-    if (arank[idx] > 0) {
-        if (atypes[idx] == std::string("int")) {
-            imas_json_plugin::uda_helpers::setReturnDataArrayType<int>(
-                interface->data_block,
-                gsl::span<const int>{static_cast<int*>(final_tree.structureComponentData(final_var)), ashape[idx][0]},
-                gsl::span<const size_t>{ashape[idx]});
-        } else if (atypes[idx] == std::string("float")) {
-            imas_json_plugin::uda_helpers::setReturnDataArrayType<float>(
-                interface->data_block,
-                gsl::span<const float>{static_cast<float*>(final_tree.structureComponentData(final_var)),
-                                       ashape[idx][0]},
-                gsl::span<const size_t>{ashape[idx]});
-        } else if (atypes[idx] == std::string("double")) {
-            imas_json_plugin::uda_helpers::setReturnDataArrayType<double>(
-                interface->data_block,
-                gsl::span<const double>{static_cast<double*>(final_tree.structureComponentData(final_var)),
-                                        ashape[idx][0]},
-                gsl::span<const size_t>{ashape[idx]});
+        if (geometry_map_reader::is_key_pattern(leaf_key)) {
+            index.for_each_match(leaf_key, add_leaf);
+        } else if (const geometry_map_reader::GeometryLeaf* leaf = index.find(leaf_key)) {
+            add_leaf(leaf_key, *leaf);
         } else {
-            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::set_return_data: Unrecognised data type\n");
+            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::set_return_batch: Key not found\n");
+            key_not_found = true;
             return 1;
         }
-    } else {
-        if (atypes[idx] == std::string("int")) {
-            imas_json_plugin::uda_helpers::setReturnDataScalarType<int>(
-                interface->data_block, *static_cast<int*>(final_tree.structureComponentData(final_var)));
-        } else if (atypes[idx] == std::string("float")) {
-            imas_json_plugin::uda_helpers::setReturnDataScalarType<float>(
-                interface->data_block, *static_cast<float*>(final_tree.structureComponentData(final_var)));
-        } else if (atypes[idx] == std::string("double")) {
-            imas_json_plugin::uda_helpers::setReturnDataScalarType<double>(
-                interface->data_block, *static_cast<double*>(final_tree.structureComponentData(final_var)));
+        if (err == geometry_map_reader::copy_leaf_alloc_error) {
+            RAISE_PLUGIN_ERROR("Failed to allocate the returned data");
+        } else if (err) {
+            return err;
+        }
+    }
+
+    if (added.empty()) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::set_return_batch: No keys matched\n");
+        key_not_found = true;
+        return 1;
+    }
+
+    builder.addString("resolved_paths", resolved_paths, "';' separated keys of the returned members");
+    return builder.setReturnData("GEOMETRY batch of geometry leaves");
+}
+
+/**
+ * Select the geometry source of a request from its optional backend argument: uda (GEOM::get through the GEOM
+ * server given by host and port) or file (geometry files under GEOMETRY_FILE_DIR). The default is set by
+ * GEOMETRY_BACKEND.
+ * @return 0 on success, non-zero if the backend is unknown or not configured
+ */
+int GeometryMapReaderPlugin::select_source(NAMEVALUELIST& args, geometry_map_reader::GeometryBackend& backend,
+                                           geometry_map_reader::GeometrySource*& geometry_source) {
+    backend = default_backend_;
+    const char* backend_name{nullptr};
+    if (findStringValue(&args, &backend_name, "backend")) {
+        if (STR_IEQUALS(backend_name, "uda")) {
+            backend = geometry_map_reader::GeometryBackend::Uda;
+        } else if (STR_IEQUALS(backend_name, "file")) {
+            backend = geometry_map_reader::GeometryBackend::File;
         } else {
-            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::set_return_data: Unrecognised data type\n");
-            return 1;
+            RAISE_PLUGIN_ERROR("Argument backend must be uda or file");
         }
     }
 
+    if (geometry_map_reader::GeometrySource* source_override = source_overrides_[static_cast<int>(backend)]) {
+        geometry_source = source_override;
+    } else if (backend == geometry_map_reader::GeometryBackend::File) {
+        if (!file_source_) {
+            RAISE_PLUGIN_ERROR("The file backend needs GEOMETRY_FILE_DIR to be set");
+        }
+        geometry_source = &*file_source_;
+    } else {
+        geometry_source = &uda_source_;
+    }
     return 0;
-};
+}
+
+/**
+ * @return the on-disk store of the backend's trees, or nullptr if they are not stored. Trees of the file backend
+ * are read from local files already, so storing them would only duplicate them and could serve stale copies
+ * after the files change.
+ */
+geometry_map_reader::GeometryStore* GeometryMapReaderPlugin::store_for(geometry_map_reader::GeometryBackend backend) {
+    if (!store_ || backend == geometry_map_reader::GeometryBackend::File) {
+        return nullptr;
+    }
+    return &*store_;
+}
 
 int GeometryMapReaderPlugin::get(IDAM_PLUGIN_INTERFACE* interface) {
 
+    geometry_map_reader::ScopedPhaseTimer total_timer{stats_, geometry_map_reader::Phase::Total};
+    geometry_map_reader::PhaseTimer timer{stats_};
+
     //////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////
     DATA_BLOCK* data_block = interface->data_block;
@@ -158,54 +311,156 @@ int GeometryMapReaderPlugin::get(IDAM_PLUGIN_INTERFACE* interface) {
     data_block->rank = 0;
     data_block->dims = nullptr;
 
+    geometry_map_reader::GeometryBackend backend;
+    geometry_map_reader::GeometrySource* geometry_source;
+    if (int err = select_source(request_data->nameValueList, backend, geometry_source)) {
+        return err;
+    }
+
     // TODO: put into plugin relevant structure
+    // Trees read from files do not depend on the endpoint or the shot, so a file is cached once for all of them
     int port{0};
-    FIND_REQUIRED_INT_VALUE(request_data->nameValueList, port);
-    const char* host{nullptr};
-    FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, host);
-    std::string const host_str{host};
-
+    const char* host{""};
     int source{0};
-    FIND_REQUIRED_INT_VALUE(request_data->nameValueList, source);
+    if (backend == geometry_map_reader::GeometryBackend::Uda) {
+        FIND_REQUIRED_INT_VALUE(request_data->nameValueList, port);
+        FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, host);
+        FIND_REQUIRED_INT_VALUE(request_data->nameValueList, source);
+    }
     const char* signal{nullptr};
     FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, signal);
-    std::string signal_str{signal};
     const char* key{nullptr};
     FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, key);
-    std::string const key_str{key};
 
-    static uda::Client client;
-    uda::Client::setServerHostName(host_str);
-    uda::Client::setServerPort(port);
+    int config{1};
+    FIND_INT_VALUE(request_data->nameValueList, config);
+
+    geometry_map_reader::ReturnOptions options;
+    const char* order{nullptr};
+    if (FIND_STRING_VALUE(request_data->nameValueList, order)) {
+        if (STR_IEQUALS(order, "F")) {
+            options.fortran_order = true;
+        } else if (!STR_IEQUALS(order, "C")) {
+            RAISE_PLUGIN_ERROR("Argument order must be C or F");
+        }
+    }
+    const char* dtype{nullptr};
+    if (FIND_STRING_VALUE(request_data->nameValueList, dtype)) {
+        if (STR_IEQUALS(dtype, "float32")) {
+            options.dtype = UDA_TYPE_FLOAT;
+        } else if (STR_IEQUALS(dtype, "float64")) {
+            options.dtype = UDA_TYPE_DOUBLE;
+        } else if (STR_IEQUALS(dtype, "int32")) {
+            options.dtype = UDA_TYPE_INT;
+        } else {
+            RAISE_PLUGIN_ERROR("Argument dtype must be float32, float64 or int32");
+        }
+    }
+    options.report_loss = findValue(&request_data->nameValueList, "report_loss");
+    const char* op{nullptr};
+    if (FIND_STRING_VALUE(request_data->nameValueList, op)) {
+        if (geometry_map_reader::parse_reduce_op(op, options.op)) {
+            RAISE_PLUGIN_ERROR("Argument op must be sum, min, max, mean, argmin, argmax or range");
+        }
+        if (options.dtype != UDA_TYPE_UNKNOWN) {
+            RAISE_PLUGIN_ERROR("Arguments op and dtype can not be combined");
+        }
+    }
+
+    // The lookup keys are reused between calls so that, once their strings have grown to fit, a request for an
+    // already cached tree makes no heap allocations before the returned data itself
+    cache_key_.host.assign(host);
+    cache_key_.port = port;
+    cache_key_.source = source;
+    cache_key_.signal.assign(signal);
+    cache_key_.config = config;
+    cache_key_.backend = backend;
+    std::transform(cache_key_.signal.begin(), cache_key_.signal.end(), cache_key_.signal.begin(), ::tolower);
+    const std::string& signal_str = cache_key_.signal;
+    timer.lap(geometry_map_reader::Phase::Parse);
 
-    // eg. GEOM::get(signal=/magnetics/pfcoil/d1_upper, Config=1);
-    std::transform(signal_str.begin(), signal_str.end(), signal_str.begin(), ::tolower);
+    // Fail fast on signals that could not be fetched and keys that could not be resolved recently
+    negative_key_.host.assign(host);
+    negative_key_.port = port;
+    negative_key_.source = source;
+    negative_key_.config = config;
+    negative_key_.signal.assign(signal_str);
+    negative_key_.key.clear();
+    negative_key_.backend = backend;
+    if (negative_cache_.contains(negative_key_)) {
+        stats_.count(geometry_map_reader::Outcome::NegativeHit);
+        RAISE_PLUGIN_ERROR("Signal recently failed to be fetched from GEOM");
+    }
+    negative_key_.key.assign(key);
+    if (negative_cache_.contains(negative_key_)) {
+        stats_.count(geometry_map_reader::Outcome::NegativeHit);
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::get: Key recently not found in geometry tree\n");
+        return 1;
+    }
 
-    std::string geom_request = fmt::format("GEOM::get(signal={}, Config=1)", signal_str);
+    const geometry_map_reader::GeometryCacheEntry* cached = cache_.find(cache_key_);
+    std::optional<geometry_map_reader::GeometryCacheEntry> fetched;
 
-    std::deque<std::string> split_vec{split_request(key_str)};
-    const uda::Result& data = client.get(geom_request, std::to_string(source));
+    timer.lap(geometry_map_reader::Phase::CacheProbe);
 
-    // Check for errors
-    if (data.errorCode() != uda::OK) {
-        RAISE_PLUGIN_ERROR("uda::Result data is not uda::OK");
+    if (cached != nullptr) {
+        stats_.count(geometry_map_reader::Outcome::CacheHit);
+    } else if (geometry_map_reader::GeometryStore* store = store_for(backend)) {
+        fetched = store->load(cache_key_);
+        timer.lap(geometry_map_reader::Phase::StoreLoad);
+        if (fetched) {
+            stats_.count(geometry_map_reader::Outcome::StoreHit);
+        }
     }
 
-    // Check this returned data is a structure: Set (register) the data tree for accessors
-    if (!data.isTree()) {
-        RAISE_PLUGIN_ERROR("Returned data is not of expected tree structure");
+    if (cached == nullptr && !fetched) {
+        if (int err = geometry_source->fetch(cache_key_, fetched)) {
+            stats_.count(geometry_map_reader::Outcome::FetchError);
+            negative_cache_.insert({host, port, source, config, signal_str, "", backend});
+            return err;
+        }
+        stats_.count(geometry_map_reader::Outcome::Fetched);
+        timer.restart();
+
+        if (geometry_map_reader::GeometryStore* store = store_for(backend)) {
+            store->save(cache_key_, *fetched->index);
+            timer.lap(geometry_map_reader::Phase::StoreSave);
+        }
     }
 
-    uda::TreeNode root_tree = data.tree();
-    // Hack to skip two levels
-    if (!tree_check(root_tree)) {
-        root_tree = root_tree.child(0);
+    if (cached == nullptr) {
+        {
+            geometry_map_reader::TraceSpan span{trace_.get(), "cache_insert", "cache"};
+            cache_.insert(cache_key_, *fetched);
+            cached = &*fetched;
+        }
+        timer.lap(geometry_map_reader::Phase::CacheInsert);
     }
-    if (!tree_check(root_tree)) {
-        root_tree = root_tree.child(0);
+
+    if (std::string_view{key}.find(';') != std::string_view::npos || geometry_map_reader::is_key_pattern(key)) {
+        bool key_not_found;
+        int err = set_return_batch(interface, *cached->index, key, options, key_not_found);
+        timer.lap(geometry_map_reader::Phase::Marshal);
+        if (key_not_found) {
+            // Only unresolved keys are remembered: other failures depend on the slices, op and dtype requested
+            stats_.count(geometry_map_reader::Outcome::KeyNotFound);
+            negative_cache_.insert(negative_key_);
+        } else if (!err) {
+            stats_.count(geometry_map_reader::Outcome::Returned);
+        }
+        return err;
     }
 
-    if (tree_node_traversal(root_tree, split_vec)) {
+    std::string_view leaf_key;
+    if (geometry_map_reader::split_key_slices(key, leaf_key, options.slices)) {
+        RAISE_PLUGIN_ERROR("Argument key has a malformed slice, eg. key=limiter.r[100:400:2]");
+    }
+    const geometry_map_reader::GeometryLeaf* leaf = cached->index->find(leaf_key);
+    timer.lap(geometry_map_reader::Phase::Lookup);
+    if (leaf == nullptr) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::get: Key not found in geometry tree\n");
+        stats_.count(geometry_map_reader::Outcome::KeyNotFound);
+        negative_cache_.insert(negative_key_);
         return 1;
     }
 
@@ -213,7 +468,730 @@ int GeometryMapReaderPlugin::get(IDAM_PLUGIN_INTERFACE* interface) {
     // (1) access experiment data
     // (2) deduce rank + type (if applicable)
     // (3) set return data (may be dependent on time or data)
-    return set_return_data(interface, root_tree, split_vec.front());
+    int err = geometry_map_reader::set_return_data(interface->data_block, *leaf, options);
+    timer.lap(geometry_map_reader::Phase::Marshal);
+    if (!err) {
+        stats_.count(geometry_map_reader::Outcome::Returned);
+    }
+    return err;
+}
+
+/**
+ * Fetch many GEOM signals into the tree cache ahead of use, eg.
+ * GEOMETRY::preload(host=..., port=..., source=..., signals=/magnetics/pfcoil/d1_upper;/magnetics/pfcoil/d1_lower)
+ *
+ * Signals that recently failed are not retried. Signals not already cached (in memory or in the on-disk store)
+ * are fetched batch signals at a time (default 32). With the uda backend each batch is one UDA batch request,
+ * costing one round trip, whose signals the GEOM server reads one after another; host and port are not needed
+ * with backend=file. The number of signals requested, fetched, already cached and failed is returned along with
+ * the failed signals (';' separated).
+ */
+int GeometryMapReaderPlugin::preload(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    geometry_map_reader::GeometryBackend backend;
+    geometry_map_reader::GeometrySource* geometry_source;
+    if (int err = select_source(request_data->nameValueList, backend, geometry_source)) {
+        return err;
+    }
+
+    int port{0};
+    const char* host{""};
+    int source{0};
+    if (backend == geometry_map_reader::GeometryBackend::Uda) {
+        FIND_REQUIRED_INT_VALUE(request_data->nameValueList, port);
+        FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, host);
+        FIND_REQUIRED_INT_VALUE(request_data->nameValueList, source);
+    }
+    const char* signals{nullptr};
+    FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, signals);
+
+    int config{1};
+    FIND_INT_VALUE(request_data->nameValueList, config);
+    int batch{32};
+    FIND_INT_VALUE(request_data->nameValueList, batch);
+    if (batch < 1) {
+        RAISE_PLUGIN_ERROR("Argument batch must be positive");
+    }
+
+    PreloadSummary summary;
+    preload_signals(*geometry_source, {host, port, source, "", config, backend}, signals, static_cast<size_t>(batch),
+                    summary);
+
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryPreload"};
+    builder.addScalar("requested", summary.requested);
+    builder.addScalar("fetched", summary.fetched);
+    builder.addScalar("cached", summary.cached);
+    builder.addScalar("failed", summary.requested - summary.fetched - summary.cached);
+    builder.addString("failed_signals", summary.failed);
+    return builder.setReturnData("GEOMETRY preload summary");
+}
+
+/**
+ * Make sure the trees of the given (';' separated) signals are in the tree cache, as for preload. base gives
+ * the backend, endpoint, source and configuration of every signal.
+ */
+void GeometryMapReaderPlugin::preload_signals(geometry_map_reader::GeometrySource& geometry_source,
+                                              const geometry_map_reader::GeometryCacheKey& base,
+                                              std::string_view signals, size_t batch, PreloadSummary& summary) {
+    const int source = base.source;
+    const int config = base.config;
+    const geometry_map_reader::GeometryBackend backend = base.backend;
+    geometry_map_reader::GeometryStore* store = store_for(backend);
+    std::vector<std::string> pending;
+
+    for_each_signal(signals, [&](std::string signal_str) {
+        ++summary.requested;
+        geometry_map_reader::GeometryCacheKey cache_key{base.host, base.port, source, signal_str, config, backend};
+        if (negative_cache_.contains({base.host, base.port, source, config, signal_str, "", backend})) {
+            summary.failed.append(summary.failed.empty() ? "" : ";").append(signal_str);
+        } else if (cache_.find(cache_key) != nullptr) {
+            ++summary.cached;
+        } else if (auto stored = store != nullptr ? store->load(cache_key) : std::nullopt) {
+            cache_.insert(cache_key, *stored);
+            ++summary.cached;
+        } else {
+            pending.push_back(std::move(signal_str));
+        }
+    });
+
+    std::vector<geometry_map_reader::GeometryCacheKey> keys;
+    std::vector<std::optional<geometry_map_reader::GeometryCacheEntry>> entries;
+
+    for (size_t first = 0; first < pending.size(); first += batch) {
+        size_t last = std::min(first + batch, pending.size());
+        geometry_map_reader::TraceSpan batch_span{trace_.get(), "preload_batch", "worker"};
+
+        keys.clear();
+        for (size_t i = first; i < last; ++i) {
+            keys.push_back({base.host, base.port, source, pending[i], config, backend});
+        }
+        geometry_source.fetch_batch(keys, entries);
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            const std::string& signal_str = keys[i].signal;
+            if (!entries[i]) {
+                negative_cache_.insert({base.host, base.port, source, config, signal_str, "", backend});
+                summary.failed.append(summary.failed.empty() ? "" : ";").append(signal_str);
+                continue;
+            }
+            if (store != nullptr) {
+                store->save(keys[i], *entries[i]->index);
+            }
+            geometry_map_reader::TraceSpan span{trace_.get(), "cache_insert", "cache"};
+            cache_.insert(keys[i], *entries[i]);
+            ++summary.fetched;
+        }
+    }
+}
+
+/**
+ * Forget the trees of the given (';' separated) signals so the next request fetches them again, eg. after their
+ * GEOM data changed: GEOMETRY::invalidate(host=..., port=..., source=..., signals=/magnetics/pfcoil/d1_upper)
+ *
+ * Takes the backend, host, port, source and config arguments of preload. The trees are dropped from the tree
+ * cache and the on-disk store, and recent failures to fetch or resolve keys in them are forgotten. Element sets,
+ * contours and wall masks are rebuilt on their next use. Returns the number of signals requested and of trees
+ * dropped from the cache and from the store.
+ */
+int GeometryMapReaderPlugin::invalidate(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    geometry_map_reader::GeometryBackend backend;
+    geometry_map_reader::GeometrySource* geometry_source;
+    if (int err = select_source(request_data->nameValueList, backend, geometry_source)) {
+        return err;
+    }
+
+    int port{0};
+    const char* host{""};
+    int source{0};
+    if (backend == geometry_map_reader::GeometryBackend::Uda) {
+        FIND_REQUIRED_INT_VALUE(request_data->nameValueList, port);
+        FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, host);
+        FIND_REQUIRED_INT_VALUE(request_data->nameValueList, source);
+    }
+    const char* signals{nullptr};
+    FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, signals);
+
+    int config{1};
+    FIND_INT_VALUE(request_data->nameValueList, config);
+
+    unsigned int requested = 0;
+    unsigned int cached = 0;
+    unsigned int stored = 0;
+    for_each_signal(signals, [&](std::string signal_str) {
+        ++requested;
+        geometry_map_reader::GeometryCacheKey cache_key{host, port, source, std::move(signal_str), config, backend};
+        cached += cache_.erase(cache_key);
+        geometry_map_reader::GeometryStore* store = store_for(backend);
+        stored += store != nullptr && store->remove(cache_key);
+        negative_cache_.erase_signal({host, port, source, config, cache_key.signal, "", backend});
+    });
+    element_sets_.clear();
+    contour_sets_.clear();
+    wall_masks_.clear();
+
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryInvalidate"};
+    builder.addScalar("requested", requested);
+    builder.addScalar("cached", cached);
+    builder.addScalar("stored", stored);
+    return builder.setReturnData("GEOMETRY invalidate summary");
+}
+
+/**
+ * Find or build the geometry elements of the trees of a request's signals, or of GEOMETRY_ELEMENT_SIGNALS when
+ * it has none. The trees are fetched as by preload, so the request takes the same backend, host, port, source
+ * and config arguments. Complete element sets are kept until reset or invalidate; sets missing a failed signal
+ * are rebuilt on the next request.
+ * @param failed set to the ';' separated signals that could not be fetched
+ * @param set_key set to the key of the element set, which identifies its trees
+ * @return 0 on success, non-zero if the arguments are invalid
+ */
+int GeometryMapReaderPlugin::load_elements(NAMEVALUELIST& args,
+                                           std::shared_ptr<const geometry_map_reader::GeometryElementSet>& elements,
+                                           std::string& failed, std::string& set_key) {
+    geometry_map_reader::GeometryBackend backend;
+    geometry_map_reader::GeometrySource* geometry_source;
+    if (int err = select_source(args, backend, geometry_source)) {
+        return err;
+    }
+
+    int port{0};
+    const char* host{""};
+    int source{0};
+    if (backend == geometry_map_reader::GeometryBackend::Uda) {
+        FIND_REQUIRED_INT_VALUE(args, port);
+        FIND_REQUIRED_STRING_VALUE(args, host);
+        FIND_REQUIRED_INT_VALUE(args, source);
+    }
+    int config{1};
+    FIND_INT_VALUE(args, config);
+    const char* signals{element_signals_.c_str()};
+    FIND_STRING_VALUE(args, signals);
+    if (signals[0] == '\0') {
+        RAISE_PLUGIN_ERROR("No geometry signals given: pass signals or set GEOMETRY_ELEMENT_SIGNALS");
+    }
+
+    set_key = fmt::format("{}|{}|{}|{}|{}|{}", static_cast<int>(backend), host, port, source, config, signals);
+    failed.clear();
+    if (auto found = element_sets_.find(set_key); found != element_sets_.end()) {
+        elements = found->second;
+        return 0;
+    }
+
+    geometry_map_reader::TraceSpan span{trace_.get(), "element_set_build", "spatial"};
+    geometry_map_reader::GeometryCacheKey base{host, port, source, "", config, backend};
+    PreloadSummary summary;
+    preload_signals(*geometry_source, base, signals, 32, summary);
+
+    // Signals missing from the cache either failed or were not retained, eg. being larger than its byte budget
+    auto element_set = std::make_shared<geometry_map_reader::GeometryElementSet>();
+    for_each_signal(signals, [&](std::string signal_str) {
+        base.signal = std::move(signal_str);
+        if (const geometry_map_reader::GeometryCacheEntry* entry = cache_.find(base)) {
+            element_set->add_tree(base.signal, *entry->index);
+        } else {
+            failed.append(failed.empty() ? "" : ";").append(base.signal);
+        }
+    });
+    element_set->build();
+    elements = element_set;
+
+    if (failed.empty()) {
+        if (element_sets_.size() >= max_element_sets) {
+            element_sets_.clear();
+        }
+        element_sets_.emplace(set_key, std::move(element_set));
+    }
+    return 0;
+}
+
+/**
+ * Find the geometry elements intersecting an (R,Z) box, eg.
+ * GEOMETRY::region(host=..., port=..., source=..., rmin=0.2, rmax=0.6, zmin=-1.0, zmax=1.0)
+ *
+ * Elements are the nodes of the signals' trees with r and z leaves (see geometry_map_reader::GeometryElement):
+ * probes and loops as points, coils as their filament rectangles and walls as polylines, each tested exactly
+ * against the box through an R-tree kept per source. The signals searched are those of the signals argument
+ * (';' separated), or of GEOMETRY_ELEMENT_SIGNALS by default. Returns the number of elements found and, per
+ * element in tree order, its signal and path (';' separated) and its bounding box.
+ */
+int GeometryMapReaderPlugin::region(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    double rmin;
+    double rmax;
+    double zmin;
+    double zmax;
+    FIND_REQUIRED_DOUBLE_VALUE(request_data->nameValueList, rmin);
+    FIND_REQUIRED_DOUBLE_VALUE(request_data->nameValueList, rmax);
+    FIND_REQUIRED_DOUBLE_VALUE(request_data->nameValueList, zmin);
+    FIND_REQUIRED_DOUBLE_VALUE(request_data->nameValueList, zmax);
+    if (rmin > rmax || zmin > zmax) {
+        RAISE_PLUGIN_ERROR("Arguments rmin and zmin must not exceed rmax and zmax");
+    }
+
+    std::shared_ptr<const geometry_map_reader::GeometryElementSet> element_set;
+    std::string failed;
+    std::string set_key;
+    if (int err = load_elements(request_data->nameValueList, element_set, failed, set_key)) {
+        return err;
+    }
+
+    geometry_map_reader::TraceSpan span{trace_.get(), "region_query", "spatial"};
+    std::vector<size_t> found = element_set->query({rmin, rmax, zmin, zmax});
+
+    std::string signals;
+    std::string paths;
+    std::vector<double> bounds[4];
+    for (size_t index : found) {
+        const geometry_map_reader::GeometryElement& element = element_set->elements()[index];
+        signals.append(signals.empty() ? "" : ";").append(element.signal);
+        paths.append(paths.empty() ? "" : ";").append(element.path);
+        bounds[0].push_back(element.bounds.rmin);
+        bounds[1].push_back(element.bounds.rmax);
+        bounds[2].push_back(element.bounds.zmin);
+        bounds[3].push_back(element.bounds.zmax);
+    }
+
+    const size_t shape[] = {found.size()};
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryRegion"};
+    builder.addScalar("count", static_cast<unsigned int>(found.size()));
+    builder.addString("signals", signals, "';' separated signal of each element");
+    builder.addString("paths", paths, "';' separated key of each element in its tree");
+    const char* names[] = {"rmin", "rmax", "zmin", "zmax"};
+    for (int i = 0; i < 4; ++i) {
+        builder.addArray<double>(names[i], gsl::span<const double>{bounds[i]}, gsl::span<const size_t>{shape},
+                                 "element bounding box");
+    }
+    builder.addString("failed_signals", failed);
+    return builder.setReturnData("GEOMETRY elements in an (R,Z) region");
+}
+
+/**
+ * Find the sensors nearest each of a batch of (R,Z) points, eg.
+ * GEOMETRY::nearest(host=..., port=..., source=..., r=0.5;0.6;0.7, z=0.0;0.1;0.2, k=3, class=pickup)
+ *
+ * Sensors are the elements of a single point (see geometry_map_reader::GeometryElementSet::nearest), searched
+ * through a KD-tree kept per source with the elements of region. The r and z arguments are ';' separated lists
+ * of equal length giving the query points. The optional class keeps only the sensors whose signal or path
+ * contains it. Returns the matching sensors (count, their signal, path, r and z) and, per query point, the
+ * indices into them of the k nearest, nearest first with equal distances in index order, and their distances.
+ * Fewer than k are returned when fewer sensors match.
+ */
+int GeometryMapReaderPlugin::nearest(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    double* r;
+    size_t nr;
+    double* z;
+    size_t nz;
+    FIND_REQUIRED_DOUBLE_ARRAY(request_data->nameValueList, r);
+    std::unique_ptr<double, decltype(&std::free)> r_owner{r, std::free};
+    FIND_REQUIRED_DOUBLE_ARRAY(request_data->nameValueList, z);
+    std::unique_ptr<double, decltype(&std::free)> z_owner{z, std::free};
+    if (nr != nz) {
+        RAISE_PLUGIN_ERROR("Arguments r and z must have the same number of values");
+    }
+
+    int k{1};
+    FIND_INT_VALUE(request_data->nameValueList, k);
+    if (k < 1) {
+        RAISE_PLUGIN_ERROR("Argument k must be at least 1");
+    }
+    const char* sensor_class{""};
+    findStringValue(&request_data->nameValueList, &sensor_class, "class");
+
+    std::shared_ptr<const geometry_map_reader::GeometryElementSet> element_set;
+    std::string failed;
+    std::string set_key;
+    if (int err = load_elements(request_data->nameValueList, element_set, failed, set_key)) {
+        return err;
+    }
+
+    geometry_map_reader::TraceSpan span{trace_.get(), "nearest_query", "spatial"};
+    const std::vector<geometry_map_reader::GeometryElement>& elements = element_set->elements();
+
+    // Number the matching sensors in tree order, the indices returned
+    const std::string_view class_name{sensor_class};
+    std::vector<int> sensor_index(elements.size(), -1);
+    std::string signals;
+    std::string paths;
+    std::vector<double> sensor_r;
+    std::vector<double> sensor_z;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        const geometry_map_reader::GeometryElement& element = elements[i];
+        if (!element_set->is_sensor(i) || (element.signal.find(class_name) == std::string::npos &&
+                                           element.path.find(class_name) == std::string::npos)) {
+            continue;
+        }
+        sensor_index[i] = static_cast<int>(sensor_r.size());
+        signals.append(signals.empty() ? "" : ";").append(element.signal);
+        paths.append(paths.empty() ? "" : ";").append(element.path);
+        sensor_r.push_back(element.r[0]);
+        sensor_z.push_back(element.z[0]);
+    }
+
+    const size_t count = std::min(static_cast<size_t>(k), sensor_r.size());
+    std::vector<int> index(nr * count);
+    std::vector<double> distance(nr * count);
+    std::vector<std::pair<double, uint32_t>> found;
+    auto accept = [&](uint32_t element) { return sensor_index[element] >= 0; };
+    for (size_t point = 0; point < nr; ++point) {
+        element_set->nearest(r[point], z[point], count, accept, found);
+        for (size_t i = 0; i < found.size(); ++i) {
+            index[point * count + i] = sensor_index[found[i].second];
+            distance[point * count + i] = found[i].first;
+        }
+    }
+
+    const size_t sensor_shape[] = {sensor_r.size()};
+    const size_t result_shape[] = {nr, count};
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryNearest"};
+    builder.addScalar("count", static_cast<unsigned int>(sensor_r.size()));
+    builder.addString("signals", signals, "';' separated signal of each sensor");
+    builder.addString("paths", paths, "';' separated key of each sensor in its tree");
+    builder.addArray<double>("r", gsl::span<const double>{sensor_r}, gsl::span<const size_t>{sensor_shape});
+    builder.addArray<double>("z", gsl::span<const double>{sensor_z}, gsl::span<const size_t>{sensor_shape});
+    builder.addArray<int>("index", gsl::span<const int>{index}, gsl::span<const size_t>{result_shape},
+                          "sensors nearest each point, nearest first");
+    builder.addArray<double>("distance", gsl::span<const double>{distance}, gsl::span<const size_t>{result_shape},
+                             "distance to each sensor in index");
+    builder.addString("failed_signals", failed);
+    return builder.setReturnData("GEOMETRY sensors nearest (R,Z) points");
+}
+
+/**
+ * Find or build the contours of a request's element set (see load_elements) whose signal or path contains the
+ * contour argument, or all its contours without one. Contour sets of complete element sets are kept until reset
+ * or invalidate.
+ * @param failed set to the ';' separated signals that could not be fetched
+ * @param contour_key set to the key of the contour set, which identifies its trees and contours
+ * @return 0 on success, non-zero if the arguments are invalid or no contour matches
+ */
+int GeometryMapReaderPlugin::load_contours(NAMEVALUELIST& args, std::shared_ptr<const Contours>& contours,
+                                           std::string& failed, std::string& contour_key) {
+    const char* contour{""};
+    FIND_STRING_VALUE(args, contour);
+
+    std::shared_ptr<const geometry_map_reader::GeometryElementSet> element_set;
+    std::string set_key;
+    if (int err = load_elements(args, element_set, failed, set_key)) {
+        return err;
+    }
+    contour_key = set_key + "|" + contour;
+    if (auto found = contour_sets_.find(contour_key); found != contour_sets_.end()) {
+        contours = found->second;
+        return 0;
+    }
+
+    geometry_map_reader::TraceSpan span{trace_.get(), "contour_set_build", "spatial"};
+    auto contour_set = std::make_shared<Contours>();
+    const std::string_view contour_name{contour};
+    const std::vector<geometry_map_reader::GeometryElement>& elements = element_set->elements();
+    for (size_t i = 0; i < elements.size(); ++i) {
+        const geometry_map_reader::GeometryElement& element = elements[i];
+        if (!element_set->is_contour(i) || (element.signal.find(contour_name) == std::string::npos &&
+                                            element.path.find(contour_name) == std::string::npos)) {
+            continue;
+        }
+        contour_set->set.add(element.r, element.z);
+        contour_set->signals.append(contour_set->signals.empty() ? "" : ";").append(element.signal);
+        contour_set->paths.append(contour_set->paths.empty() ? "" : ";").append(element.path);
+    }
+    if (contour_set->set.contours() == 0) {
+        RAISE_PLUGIN_ERROR("No geometry contours found: check the signals and contour arguments");
+    }
+    contour_set->set.build();
+    contours = contour_set;
+
+    if (failed.empty()) {
+        if (contour_sets_.size() >= max_element_sets) {
+            contour_sets_.clear();
+        }
+        contour_sets_.emplace(contour_key, std::move(contour_set));
+    }
+    return 0;
+}
+
+/**
+ * Test a batch of (R,Z) points against the limiter or wall contours of a source, eg.
+ * GEOMETRY::inside(host=..., port=..., source=..., r=0.5;0.6;0.7, z=0.0;0.1;0.2, contour=wall, distance)
+ *
+ * Contours are the elements that are polylines of at least 3 points, closed back to their first point, whose
+ * signal or path contains the optional contour argument. A point is inside by the crossing number of all their
+ * edges, so nested contours bound the region between them. The edges are bucketed by Z into bands once per
+ * source and contour, so each point is tested against the few edges of its band. Returns the contours used
+ * (count, their signal and path), the inside mask (1 inside, 0 outside) and, with the distance flag, the signed
+ * distance of each point to the nearest edge, negative inside.
+ */
+int GeometryMapReaderPlugin::inside(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    double* r;
+    size_t nr;
+    double* z;
+    size_t nz;
+    FIND_REQUIRED_DOUBLE_ARRAY(request_data->nameValueList, r);
+    std::unique_ptr<double, decltype(&std::free)> r_owner{r, std::free};
+    FIND_REQUIRED_DOUBLE_ARRAY(request_data->nameValueList, z);
+    std::unique_ptr<double, decltype(&std::free)> z_owner{z, std::free};
+    if (nr != nz) {
+        RAISE_PLUGIN_ERROR("Arguments r and z must have the same number of values");
+    }
+    bool with_distance = findValue(&request_data->nameValueList, "distance");
+
+    std::shared_ptr<const Contours> contours;
+    std::string failed;
+    std::string contour_key;
+    if (int err = load_contours(request_data->nameValueList, contours, failed, contour_key)) {
+        return err;
+    }
+
+    geometry_map_reader::TraceSpan span{trace_.get(), "inside_query", "spatial"};
+    auto mask = static_cast<unsigned char*>(malloc(std::max<size_t>(nr, 1) * sizeof(unsigned char)));
+    if (mask == nullptr) {
+        RAISE_PLUGIN_ERROR("Failed to allocate the inside mask");
+    }
+    contours->set.inside(r, z, nr, mask);
+
+    const size_t shape[] = {nr};
+    const char* type_name = with_distance ? "GeometryInsideDistance" : "GeometryInside";
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, type_name};
+    builder.addScalar("count", static_cast<unsigned int>(contours->set.contours()));
+    builder.addString("signals", contours->signals, "';' separated signal of each contour");
+    builder.addString("paths", contours->paths, "';' separated key of each contour in its tree");
+    builder.addOwnedArray<unsigned char>("inside", mask, nr, gsl::span<const size_t>{shape},
+                                         "1 if the point is inside the contours, else 0");
+    if (with_distance) {
+        auto distance = static_cast<double*>(malloc(std::max<size_t>(nr, 1) * sizeof(double)));
+        if (distance == nullptr) {
+            RAISE_PLUGIN_ERROR("Failed to allocate the distances");
+        }
+        contours->set.signed_distance(r, z, nr, mask, distance);
+        builder.addOwnedArray<double>("distance", distance, nr, gsl::span<const size_t>{shape},
+                                      "distance to the nearest contour edge, negative inside");
+    }
+    builder.addString("failed_signals", failed);
+    return builder.setReturnData("GEOMETRY points inside the wall contours");
+}
+
+/**
+ * Rasterise the limiter or wall contours of a source on an (R,Z) grid, eg.
+ * GEOMETRY::wallmask(host=..., port=..., source=..., nr=129, nz=257, contour=wall)
+ *
+ * The contours are those of inside, selected by the optional contour argument. The grid has nr x nz points evenly
+ * spaced over rmin..rmax and zmin..zmax inclusive, by default the bounds of the contours. The rows are computed
+ * in parallel over GEOMETRY_RASTER_THREADS threads. Rasters of complete contour sets are kept per source, contour
+ * and grid until reset or invalidate. Returns the contours used (count, their signal and path), the grid
+ * coordinates r and z, and per grid point, in nz rows of nr points, the inside mask (1 inside, 0 outside) and the
+ * signed distance to the nearest edge, negative inside.
+ */
+int GeometryMapReaderPlugin::wallmask(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    int nr;
+    int nz;
+    FIND_REQUIRED_INT_VALUE(request_data->nameValueList, nr);
+    FIND_REQUIRED_INT_VALUE(request_data->nameValueList, nz);
+    if (nr < 2 || nz < 2) {
+        RAISE_PLUGIN_ERROR("Arguments nr and nz must be at least 2");
+    }
+    if (static_cast<size_t>(nr) * static_cast<size_t>(nz) > max_raster_points) {
+        RAISE_PLUGIN_ERROR("Wall mask grid is too large: reduce nr or nz");
+    }
+
+    std::shared_ptr<const Contours> contours;
+    std::string failed;
+    std::string contour_key;
+    if (int err = load_contours(request_data->nameValueList, contours, failed, contour_key)) {
+        return err;
+    }
+
+    const geometry_map_reader::Box& bounds = contours->set.bounds();
+    double rmin{bounds.rmin};
+    double rmax{bounds.rmax};
+    double zmin{bounds.zmin};
+    double zmax{bounds.zmax};
+    FIND_DOUBLE_VALUE(request_data->nameValueList, rmin);
+    FIND_DOUBLE_VALUE(request_data->nameValueList, rmax);
+    FIND_DOUBLE_VALUE(request_data->nameValueList, zmin);
+    FIND_DOUBLE_VALUE(request_data->nameValueList, zmax);
+    if (!(rmin <= rmax && zmin <= zmax)) {
+        RAISE_PLUGIN_ERROR("Arguments rmin and zmin must not exceed rmax and zmax");
+    }
+    const geometry_map_reader::RasterGrid grid{rmin, rmax, zmin, zmax, static_cast<size_t>(nr),
+                                               static_cast<size_t>(nz)};
+
+    std::string mask_key = fmt::format("{}|{}|{}|{}|{}|{}|{}", contour_key, rmin, rmax, zmin, zmax, nr, nz);
+    std::shared_ptr<const WallMask> wall_mask;
+    if (auto found = wall_masks_.find(mask_key); found != wall_masks_.end()) {
+        wall_mask = found->second;
+    } else {
+        geometry_map_reader::TraceSpan span{trace_.get(), "wallmask_raster", "spatial"};
+        auto raster = std::make_shared<WallMask>();
+        raster->grid = grid;
+        raster->inside.resize(grid.nr * grid.nz);
+        raster->distance.resize(grid.nr * grid.nz);
+        geometry_map_reader::rasterise(contours->set, grid, raster_threads_, raster->inside.data(),
+                                       raster->distance.data());
+        wall_mask = raster;
+        if (failed.empty()) {
+            if (wall_masks_.size() >= max_wall_masks) {
+                wall_masks_.clear();
+            }
+            wall_masks_.emplace(std::move(mask_key), std::move(raster));
+        }
+    }
+
+    std::vector<double> r(grid.nr);
+    std::vector<double> z(grid.nz);
+    for (size_t i = 0; i < grid.nr; ++i) {
+        r[i] = grid.r(i);
+    }
+    for (size_t j = 0; j < grid.nz; ++j) {
+        z[j] = grid.z(j);
+    }
+
+    const size_t r_shape[] = {grid.nr};
+    const size_t z_shape[] = {grid.nz};
+    const size_t shape[] = {grid.nz, grid.nr};
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryWallMask"};
+    builder.addScalar("count", static_cast<unsigned int>(contours->set.contours()));
+    builder.addString("signals", contours->signals, "';' separated signal of each contour");
+    builder.addString("paths", contours->paths, "';' separated key of each contour in its tree");
+    builder.addArray<double>("r", gsl::span<const double>{r}, gsl::span<const size_t>{r_shape}, "grid R");
+    builder.addArray<double>("z", gsl::span<const double>{z}, gsl::span<const size_t>{z_shape}, "grid Z");
+    builder.addArray<unsigned char>("inside", gsl::span<const unsigned char>{wall_mask->inside},
+                                    gsl::span<const size_t>{shape}, "1 if the point is inside the contours, else 0");
+    builder.addArray<double>("distance", gsl::span<const double>{wall_mask->distance},
+                             gsl::span<const size_t>{shape}, "distance to the nearest contour edge, negative inside");
+    builder.addString("failed_signals", failed);
+    return builder.setReturnData("GEOMETRY wall mask on an (R,Z) grid");
+}
+
+/**
+ * Report request latency per phase and request outcome counts, eg. GEOMETRY::stats(reset)
+ *
+ * Phase names (';' separated) are returned with, per phase, the number of timings and the mean, p50, p99, p999
+ * and maximum latency in microseconds. Outcome names (';' separated) are returned with their counts. Passing
+ * reset clears the statistics after they are reported.
+ */
+int GeometryMapReaderPlugin::stats(IDAM_PLUGIN_INTERFACE* interface) {
+
+    constexpr size_t phase_count = static_cast<size_t>(geometry_map_reader::Phase::Count);
+    constexpr size_t outcome_count = static_cast<size_t>(geometry_map_reader::Outcome::Count);
+    constexpr double ns_per_us = 1000.0;
+
+    std::string phases;
+    std::vector<unsigned long> counts;
+    std::vector<double> mean;
+    std::vector<double> p50;
+    std::vector<double> p99;
+    std::vector<double> p999;
+    std::vector<double> max;
+    for (size_t i = 0; i < phase_count; ++i) {
+        auto phase = static_cast<geometry_map_reader::Phase>(i);
+        const geometry_map_reader::LatencyHistogram& histogram = stats_.histogram(phase);
+        phases.append(phases.empty() ? "" : ";").append(geometry_map_reader::phase_name(phase));
+        counts.push_back(histogram.count());
+        mean.push_back(histogram.mean() / ns_per_us);
+        p50.push_back(static_cast<double>(histogram.percentile(0.5)) / ns_per_us);
+        p99.push_back(static_cast<double>(histogram.percentile(0.99)) / ns_per_us);
+        p999.push_back(static_cast<double>(histogram.percentile(0.999)) / ns_per_us);
+        max.push_back(static_cast<double>(histogram.max()) / ns_per_us);
+    }
+
+    std::string outcomes;
+    std::vector<unsigned long> outcome_counts;
+    for (size_t i = 0; i < outcome_count; ++i) {
+        auto outcome = static_cast<geometry_map_reader::Outcome>(i);
+        outcomes.append(outcomes.empty() ? "" : ";").append(geometry_map_reader::outcome_name(outcome));
+        outcome_counts.push_back(stats_.counter(outcome));
+    }
+
+    const size_t phase_shape = phase_count;
+    const size_t outcome_shape = outcome_count;
+
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryStats"};
+    builder.addString("phases", phases);
+    builder.addArray<unsigned long>("count", gsl::span<const unsigned long>{counts}, {&phase_shape, 1});
+    builder.addArray<double>("mean_us", gsl::span<const double>{mean}, {&phase_shape, 1});
+    builder.addArray<double>("p50_us", gsl::span<const double>{p50}, {&phase_shape, 1});
+    builder.addArray<double>("p99_us", gsl::span<const double>{p99}, {&phase_shape, 1});
+    builder.addArray<double>("p999_us", gsl::span<const double>{p999}, {&phase_shape, 1});
+    builder.addArray<double>("max_us", gsl::span<const double>{max}, {&phase_shape, 1});
+    builder.addString("outcomes", outcomes);
+    builder.addArray<unsigned long>("outcome_count", gsl::span<const unsigned long>{outcome_counts},
+                                    {&outcome_shape, 1});
+
+    if (findValue(&interface->request_data->nameValueList, "reset")) {
+        stats_.reset();
+    }
+
+    return builder.setReturnData("GEOMETRY request statistics");
+}
+
+/**
+ * Report the pooled GEOM server connections: endpoint names (';' separated), the number of requests made
+ * through each and the seconds since each was last used.
+ */
+int GeometryMapReaderPlugin::connections(IDAM_PLUGIN_INTERFACE* interface) {
+
+    std::vector<geometry_map_reader::EndpointStats> stats = uda_source_.clients().stats();
+
+    std::string endpoints;
+    std::vector<unsigned long> requests;
+    std::vector<double> idle;
+    for (const auto& endpoint : stats) {
+        endpoints.append(endpoints.empty() ? "" : ";").append(endpoint.endpoint);
+        requests.push_back(endpoint.requests);
+        idle.push_back(endpoint.idle_seconds);
+    }
+    const size_t count = stats.size();
+
+    imas_json_plugin::uda_helpers::StructureBuilder builder{interface, "GeometryConnections"};
+    builder.addScalar<unsigned int>("count", static_cast<unsigned int>(count));
+    builder.addString("endpoints", endpoints);
+    builder.addArray<unsigned long>("requests", gsl::span<const unsigned long>{requests},
+                                    gsl::span<const size_t>{&count, 1});
+    builder.addArray<double>("idle", gsl::span<const double>{idle}, gsl::span<const size_t>{&count, 1});
+    return builder.setReturnData("GEOMETRY pooled GEOM connections");
+}
+
+/**
+ * Write the buffered trace events to a Chrome trace JSON file, viewable in Perfetto or chrome://tracing.
+ * Tracing is enabled by setting GEOMETRY_TRACE_EVENTS to the number of events to buffer.
+ * Arguments: path (required), clear (flag, discard the written events)
+ * @return the number of events written
+ */
+int GeometryMapReaderPlugin::dump_trace(IDAM_PLUGIN_INTERFACE* interface) {
+
+    const char* path;
+    FIND_REQUIRED_STRING_VALUE(interface->request_data->nameValueList, path);
+
+    if (!trace_) {
+        RAISE_PLUGIN_ERROR("Tracing is not enabled: set GEOMETRY_TRACE_EVENTS to the number of events to buffer");
+    }
+
+    long written = trace_->write_chrome_trace(path);
+    if (written < 0) {
+        UDA_LOG(UDA_LOG_ERROR, "\nimas_json_plugin::plugin_helpers::dump_trace: Unable to write %s\n", path);
+        RAISE_PLUGIN_ERROR("Unable to write the trace file");
+    }
+
+    if (findValue(&interface->request_data->nameValueList, "clear")) {
+        trace_->clear();
+    }
+
+    return setReturnDataIntScalar(interface->data_block, static_cast<int>(written), "number of trace events");
 }
 
 int GeometryMapReader(IDAM_PLUGIN_INTERFACE* plugin_interface) {
@@ -276,6 +1254,24 @@ int GeometryMapReader(IDAM_PLUGIN_INTERFACE* plugin_interface) {
             return plugin.max_interface_version(plugin_interface);
         } else if (STR_IEQUALS(plugin_func, "get")) {
             return plugin.get(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "preload")) {
+            return plugin.preload(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "invalidate")) {
+            return plugin.invalidate(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "stats")) {
+            return plugin.stats(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "connections")) {
+            return plugin.connections(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "dumptrace")) {
+            return plugin.dump_trace(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "region")) {
+            return plugin.region(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "nearest")) {
+            return plugin.nearest(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "inside")) {
+            return plugin.inside(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "wallmask")) {
+            return plugin.wallmask(plugin_interface);
         } else {
             RAISE_PLUGIN_ERROR("Unknown function requested!");
         }
@@ -290,8 +1286,42 @@ int GeometryMapReader(IDAM_PLUGIN_INTERFACE* plugin_interface) {
  * @return
  */
 int GeometryMapReaderPlugin::help(IDAM_PLUGIN_INTERFACE* interface) {
-    const char* help = "\ntemplatePlugin: Add Functions Names, Syntax, and Descriptions\n\n";
-    const char* desc = "templatePlugin: help = description of this plugin";
+    const char* help =
+        "\nGEOMETRY: reads MAST-U geometry trees fetched with GEOM::get, caching them per GEOM server\n\n"
+        "Tree requests take a backend (uda or file, default GEOMETRY_BACKEND), the host and port of the GEOM\n"
+        "server and a source (shot), for the uda backend only, and an optional config (default 1).\n\n"
+        "get(host, port, source, signal, key, [config], [backend], [order=C|F], [dtype=float32|float64|int32],\n"
+        "    [report_loss], [op=sum|min|max|mean|argmin|argmax|range])\n"
+        "    Return the leaf of a signal's tree at key, eg. key=limiter.r. A key may be sliced, eg.\n"
+        "    key=limiter.r[100:400:2], and ';' separated keys or glob patterns, eg. key=coils.*.turns, return a\n"
+        "    structure with a member per resolved key. op reduces each leaf, dtype converts it and report_loss\n"
+        "    reports the precision lost converting it.\n\n"
+        "preload(host, port, source, signals, [config], [backend], [batch=32])\n"
+        "    Fetch the ';' separated signals into the tree cache, batch signals per request.\n\n"
+        "invalidate(host, port, source, signals, [config], [backend])\n"
+        "    Drop the trees of the ';' separated signals from the tree cache and the on-disk store.\n\n"
+        "region(host, port, source, rmin, rmax, zmin, zmax, [signals], [config], [backend])\n"
+        "    Find the geometry elements intersecting an (R,Z) box, searching the ';' separated signals or\n"
+        "    GEOMETRY_ELEMENT_SIGNALS.\n\n"
+        "nearest(host, port, source, r, z, [k=1], [class], [signals], [config], [backend])\n"
+        "    Find the k sensors nearest each point of the ';' separated r and z lists, optionally only those\n"
+        "    whose signal or path contains class.\n\n"
+        "inside(host, port, source, r, z, [contour], [distance], [signals], [config], [backend])\n"
+        "    Test the points of the ';' separated r and z lists against the wall contours whose signal or path\n"
+        "    contains contour. distance also returns their signed distance to the nearest edge.\n\n"
+        "wallmask(host, port, source, nr, nz, [rmin], [rmax], [zmin], [zmax], [contour], [signals], [config],\n"
+        "         [backend])\n"
+        "    Rasterise the inside mask and signed distance of the wall contours on an nr x nz (R,Z) grid, by\n"
+        "    default over the bounds of the contours.\n\n"
+        "stats([reset])\n"
+        "    Report request latency per phase and request outcome counts, then clear them with reset.\n\n"
+        "connections()\n"
+        "    Report the pooled GEOM server connections, their request counts and idle times.\n\n"
+        "dumptrace(path, [clear])\n"
+        "    Write the buffered trace events (GEOMETRY_TRACE_EVENTS) to a Chrome trace JSON file at path, then\n"
+        "    discard them with clear.\n\n"
+        "help(), version(), builddate(), defaultmethod(), maxinterfaceversion()\n\n";
+    const char* desc = "GEOMETRY: help = description of this plugin";
 
     return setReturnDataString(interface->data_block, help, desc);
 }
@@ -0,0 +1,115 @@
+#ifndef GEOMETRY_MAP_READER_GEOMETRY_PLUGIN_H
+#define GEOMETRY_MAP_READER_GEOMETRY_PLUGIN_H
+
+#include <clientserver/udaStructs.h>
+#include <plugins/pluginStructs.h>
+
+#include "geometry_cache.h"
+#include "geometry_source.h"
+#include "geometry_source_file.h"
+#include "geometry_source_uda.h"
+#include "geometry_spatial.h"
+#include "geometry_stats.h"
+#include "geometry_store.h"
+#include "geometry_trace.h"
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * State and functions of the GEOMETRY plugin. The GeometryMapReader entry function dispatches requests to a single
+ * instance; tests and benchmarks may drive their own instance, serving trees from memory with set_source.
+ */
+class GeometryMapReaderPlugin {
+  public:
+    void init(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    void reset(IDAM_PLUGIN_INTERFACE* plugin_interface);
+
+    /**
+     * Serve the requests of a backend from the given source rather than the configured one, until the next reset.
+     * The source must outlive its use by the plugin.
+     */
+    void set_source(geometry_map_reader::GeometryBackend backend, geometry_map_reader::GeometrySource* source);
+
+    int help(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int version(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int build_date(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int default_method(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int max_interface_version(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int get(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int connections(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int preload(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int invalidate(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int stats(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int dump_trace(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int region(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int nearest(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int inside(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int wallmask(IDAM_PLUGIN_INTERFACE* plugin_interface);
+
+  private:
+    static constexpr size_t max_element_sets = 16;
+    static constexpr size_t max_wall_masks = 8;
+    static constexpr size_t max_raster_points = size_t{1} << 22;
+
+    struct PreloadSummary {
+        unsigned int requested = 0;
+        unsigned int fetched = 0;
+        unsigned int cached = 0;
+        std::string failed;
+    };
+
+    // The contours of an element set matching a contour name, with the signal and path of each (';' separated)
+    struct Contours {
+        geometry_map_reader::ContourSet set;
+        std::string signals;
+        std::string paths;
+    };
+
+    // A rasterised wall mask: nz rows of nr points
+    struct WallMask {
+        geometry_map_reader::RasterGrid grid;
+        std::vector<unsigned char> inside;
+        std::vector<double> distance;
+    };
+
+    int select_source(NAMEVALUELIST& args, geometry_map_reader::GeometryBackend& backend,
+                      geometry_map_reader::GeometrySource*& geometry_source);
+    geometry_map_reader::GeometryStore* store_for(geometry_map_reader::GeometryBackend backend);
+    void preload_signals(geometry_map_reader::GeometrySource& geometry_source,
+                         const geometry_map_reader::GeometryCacheKey& base, std::string_view signals, size_t batch,
+                         PreloadSummary& summary);
+    int load_elements(NAMEVALUELIST& args, std::shared_ptr<const geometry_map_reader::GeometryElementSet>& elements,
+                      std::string& failed, std::string& set_key);
+    int load_contours(NAMEVALUELIST& args, std::shared_ptr<const Contours>& contours, std::string& failed,
+                      std::string& contour_key);
+
+    bool init_ = false;
+    geometry_map_reader::PluginStats stats_;
+    geometry_map_reader::UdaGeometrySource uda_source_{stats_};
+    std::optional<geometry_map_reader::FileGeometrySource> file_source_;
+    // Sources set with set_source, by backend
+    geometry_map_reader::GeometrySource* source_overrides_[2] = {};
+    geometry_map_reader::GeometryBackend default_backend_ = geometry_map_reader::GeometryBackend::Uda;
+    geometry_map_reader::GeometryTreeCache cache_;
+    geometry_map_reader::NegativeCache negative_cache_;
+    geometry_map_reader::GeometryCacheKey cache_key_;
+    geometry_map_reader::NegativeCacheKey negative_key_;
+    std::optional<geometry_map_reader::GeometryStore> store_;
+    std::unique_ptr<geometry_map_reader::TraceBuffer> trace_;
+    std::string element_signals_;
+    // Complete element sets by request endpoint, source, config and signals
+    std::unordered_map<std::string, std::shared_ptr<const geometry_map_reader::GeometryElementSet>>
+        element_sets_;
+    // Contour sets by element set key and contour name
+    std::unordered_map<std::string, std::shared_ptr<const Contours>> contour_sets_;
+    size_t raster_threads_ = 1;
+    // Wall masks by contour set key and grid
+    std::unordered_map<std::string, std::shared_ptr<const WallMask>> wall_masks_;
+};
+
+#endif // GEOMETRY_MAP_READER_GEOMETRY_PLUGIN_H
@@ -0,0 +1,282 @@
+#include "geometry_return.h"
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <type_traits>
+
+#include "utils/uda_plugin_helpers.hpp"
+
+namespace geometry_map_reader {
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && text.back() == ' ') {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+/**
+ * Parse an optional integer, where empty text leaves value unset
+ * @return true on success
+ */
+bool parse_bound(std::string_view text, std::optional<long>& value) {
+    text = trim(text);
+    if (text.empty()) {
+        value.reset();
+        return true;
+    }
+    long parsed = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+/**
+ * Parse one dimension of a slice: an index i or start:stop[:step], any of which may be omitted
+ * @return true on success
+ */
+bool parse_dim_slice(std::string_view text, DimSlice& slice) {
+    auto first = text.find(':');
+    if (first == std::string_view::npos) {
+        slice.index = true;
+        return parse_bound(text, slice.start) && slice.start.has_value();
+    }
+    auto second = text.find(':', first + 1);
+    if (!parse_bound(text.substr(0, first), slice.start) ||
+        !parse_bound(text.substr(first + 1, second == std::string_view::npos ? second : second - first - 1),
+                     slice.stop)) {
+        return false;
+    }
+    if (second != std::string_view::npos) {
+        std::optional<long> step;
+        if (!parse_bound(text.substr(second + 1), step)) {
+            return false;
+        }
+        slice.step = step.value_or(1);
+    }
+    return slice.step != 0;
+}
+
+const char* type_name(UDA_TYPE type) {
+    switch (type) {
+        case UDA_TYPE_CHAR:
+            return "int8";
+        case UDA_TYPE_UNSIGNED_CHAR:
+            return "uint8";
+        case UDA_TYPE_SHORT:
+            return "int16";
+        case UDA_TYPE_UNSIGNED_SHORT:
+            return "uint16";
+        case UDA_TYPE_INT:
+            return "int32";
+        case UDA_TYPE_UNSIGNED_INT:
+            return "uint32";
+        case UDA_TYPE_LONG:
+        case UDA_TYPE_LONG64:
+            return "int64";
+        case UDA_TYPE_UNSIGNED_LONG:
+        case UDA_TYPE_UNSIGNED_LONG64:
+            return "uint64";
+        case UDA_TYPE_FLOAT:
+            return "float32";
+        case UDA_TYPE_DOUBLE:
+            return "float64";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace
+
+std::string describe_conversion(const imas_json_plugin::array_kernels::ConversionLoss& loss, UDA_TYPE from,
+                                UDA_TYPE to) {
+    return fmt::format("converted {} to {}: {} of {} values changed, max abs error {:g}", type_name(from),
+                       type_name(to), loss.changed, loss.count, loss.max_abs_error);
+}
+
+int parse_reduce_op(std::string_view name, ReduceOp& op) {
+    constexpr std::pair<std::string_view, ReduceOp> ops[] = {
+        {"sum", ReduceOp::Sum},       {"min", ReduceOp::Min},       {"max", ReduceOp::Max},
+        {"mean", ReduceOp::Mean},     {"argmin", ReduceOp::Argmin}, {"argmax", ReduceOp::Argmax},
+        {"range", ReduceOp::Range},
+    };
+    for (const auto& [op_name, value] : ops) {
+        if (name == op_name) {
+            op = value;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int split_key_slices(std::string_view key, std::string_view& leaf_key, std::vector<DimSlice>& slices) {
+    slices.clear();
+    auto open = key.find('[');
+    leaf_key = key.substr(0, open);
+    if (open == std::string_view::npos) {
+        return 0;
+    }
+
+    std::string_view suffix = key.substr(open);
+    while (!suffix.empty()) {
+        auto close = suffix.find(']');
+        if (suffix.front() != '[' || close == std::string_view::npos) {
+            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::split_key_slices: Malformed key slice\n");
+            return 1;
+        }
+        std::string_view dims = suffix.substr(1, close - 1);
+        suffix.remove_prefix(close + 1);
+        while (true) {
+            auto comma = dims.find(',');
+            if (!parse_dim_slice(dims.substr(0, comma), slices.emplace_back())) {
+                UDA_LOG(UDA_LOG_DEBUG,
+                        "\nimas_json_plugin::plugin_helpers::split_key_slices: Malformed key slice\n");
+                return 1;
+            }
+            if (comma == std::string_view::npos) {
+                break;
+            }
+            dims.remove_prefix(comma + 1);
+        }
+    }
+    return 0;
+}
+
+int resolve_slices(gsl::span<const DimSlice> slices, gsl::span<const size_t> shape,
+                   std::vector<imas_json_plugin::array_kernels::AxisRange>& ranges,
+                   std::vector<size_t>& sliced_shape) {
+    if (slices.size() > shape.size()) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::resolve_slices: More slices than dimensions\n");
+        return 1;
+    }
+
+    ranges.clear();
+    sliced_shape.clear();
+    for (size_t dim = 0; dim < shape.size(); ++dim) {
+        const long size = static_cast<long>(shape[dim]);
+        if (dim >= slices.size()) {
+            ranges.push_back({0, 1, shape[dim]});
+            sliced_shape.push_back(shape[dim]);
+            continue;
+        }
+
+        const DimSlice& slice = slices[dim];
+        if (slice.index) {
+            long index = *slice.start < 0 ? *slice.start + size : *slice.start;
+            if (index < 0 || index >= size) {
+                UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::resolve_slices: Index out of range\n");
+                return 1;
+            }
+            ranges.push_back({static_cast<size_t>(index), 1, 1});
+            continue;
+        }
+
+        // As Python's slice.indices: clamp the bounds to [0, size] going forwards and [-1, size - 1] backwards
+        const long step = slice.step;
+        const long lower = step > 0 ? 0 : -1;
+        const long upper = step > 0 ? size : size - 1;
+        auto clamp = [&](std::optional<long> bound, long fallback) {
+            if (!bound) {
+                return fallback;
+            }
+            long value = *bound < 0 ? *bound + size : *bound;
+            return std::clamp(value, lower, upper);
+        };
+        const long start = clamp(slice.start, step > 0 ? lower : upper);
+        const long stop = clamp(slice.stop, step > 0 ? upper : lower);
+
+        size_t count = 0;
+        if (step > 0 && stop > start) {
+            count = static_cast<size_t>((stop - start + step - 1) / step);
+        } else if (step < 0 && start > stop) {
+            count = static_cast<size_t>((start - stop - step - 1) / -step);
+        }
+        ranges.push_back({count > 0 ? static_cast<size_t>(start) : 0, step, count});
+        sliced_shape.push_back(count);
+    }
+    return 0;
+}
+
+int set_return_data(DATA_BLOCK* data_block, const GeometryLeaf& leaf, const ReturnOptions& options) {
+
+    if (options.op != ReduceOp::None) {
+        int err = reduce_leaf(leaf, options, [&](auto values) {
+            using R = std::remove_const_t<typename decltype(values)::element_type>;
+            if (values.size() == 1) {
+                imas_json_plugin::uda_helpers::setReturnDataScalarType<R>(data_block, values[0]);
+            } else {
+                const size_t shape[] = {values.size()};
+                imas_json_plugin::uda_helpers::setReturnDataArrayType<R>(data_block, values,
+                                                                         gsl::span<const size_t>{shape});
+            }
+        });
+        if (err == copy_leaf_alloc_error) {
+            RAISE_PLUGIN_ERROR("Failed to allocate the values to reduce");
+        }
+        return err;
+    }
+
+    if ((leaf.type == UDA_TYPE_STRING || leaf.rank == 0) && !options.slices.empty()) {
+        UDA_LOG(UDA_LOG_DEBUG,
+                "\nimas_json_plugin::plugin_helpers::set_return_data: Strings and scalars can not be sliced\n");
+        return 1;
+    }
+
+    if (leaf.type == UDA_TYPE_STRING) {
+        const char* value = leaf.data != nullptr ? static_cast<const char*>(leaf.data) : "";
+        return setReturnDataString(data_block, value, nullptr);
+    }
+
+    int err = 0;
+    int type_err = visit_leaf_as(leaf, options, [&](auto* data, auto* as) {
+        using T = std::remove_const_t<std::remove_pointer_t<decltype(data)>>;
+        using U = std::remove_pointer_t<decltype(as)>;
+        imas_json_plugin::array_kernels::ConversionLoss loss;
+        auto* report = options.report_loss && !std::is_same_v<T, U> ? &loss : nullptr;
+        std::string description;
+
+        // Would be good to use apoint here but seems to be false every time
+        if (leaf.rank > 0) {
+            std::vector<size_t> shape;
+            U* out = nullptr;
+            err = copy_leaf<U>(data, leaf, options, out, shape, report);
+            if (err) {
+                return;
+            }
+            if (report != nullptr) {
+                description = describe_conversion(loss, leaf.type, options.dtype);
+            }
+            const char* desc = report != nullptr ? description.c_str() : nullptr;
+            if (shape.empty()) {
+                imas_json_plugin::uda_helpers::setReturnDataScalarType<U>(data_block, *out, desc);
+                free(out);
+            } else {
+                imas_json_plugin::uda_helpers::setReturnDataArrayOwned<U>(data_block, out,
+                                                                          gsl::span<const size_t>{shape}, desc);
+            }
+        } else {
+            U value;
+            imas_json_plugin::array_kernels::convert(data, 1, &value, report);
+            if (report != nullptr) {
+                description = describe_conversion(loss, leaf.type, options.dtype);
+            }
+            imas_json_plugin::uda_helpers::setReturnDataScalarType<U>(
+                data_block, value, report != nullptr ? description.c_str() : nullptr);
+        }
+    });
+    if (err == copy_leaf_alloc_error) {
+        RAISE_PLUGIN_ERROR("Failed to allocate the returned data");
+    }
+    return type_err ? type_err : err;
+}
+
+} // namespace geometry_map_reader
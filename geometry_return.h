@@ -0,0 +1,342 @@
+#ifndef GEOMETRY_MAP_READER_RETURN_H
+#define GEOMETRY_MAP_READER_RETURN_H
+
+#include <clientserver/udaStructs.h>
+#include <clientserver/udaTypes.h>
+#include <plugins/udaPlugin.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "geometry_index.h"
+#include "utils/array_kernels.hpp"
+
+namespace geometry_map_reader {
+
+/**
+ * Call visitor with a typed pointer to the leaf data. Strings are not visited and must be handled by the caller.
+ * @return 0 on success, 1 if the leaf type is not supported
+ */
+template <typename F> int visit_leaf(const GeometryLeaf& leaf, F&& visitor) {
+    switch (leaf.type) {
+        case UDA_TYPE_CHAR:
+            visitor(static_cast<const char*>(leaf.data));
+            break;
+        case UDA_TYPE_UNSIGNED_CHAR:
+            visitor(static_cast<const unsigned char*>(leaf.data));
+            break;
+        case UDA_TYPE_SHORT:
+            visitor(static_cast<const short*>(leaf.data));
+            break;
+        case UDA_TYPE_UNSIGNED_SHORT:
+            visitor(static_cast<const unsigned short*>(leaf.data));
+            break;
+        case UDA_TYPE_INT:
+            visitor(static_cast<const int*>(leaf.data));
+            break;
+        case UDA_TYPE_UNSIGNED_INT:
+            visitor(static_cast<const unsigned int*>(leaf.data));
+            break;
+        case UDA_TYPE_LONG:
+            visitor(static_cast<const long*>(leaf.data));
+            break;
+        case UDA_TYPE_UNSIGNED_LONG:
+            visitor(static_cast<const unsigned long*>(leaf.data));
+            break;
+        case UDA_TYPE_LONG64:
+            visitor(static_cast<const long long*>(leaf.data));
+            break;
+        case UDA_TYPE_UNSIGNED_LONG64:
+            visitor(static_cast<const unsigned long long*>(leaf.data));
+            break;
+        case UDA_TYPE_FLOAT:
+            visitor(static_cast<const float*>(leaf.data));
+            break;
+        case UDA_TYPE_DOUBLE:
+            visitor(static_cast<const double*>(leaf.data));
+            break;
+        default:
+            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::visit_leaf: Unrecognised data type\n");
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * A slice of one array dimension with Python semantics: start, start + step, ... up to but excluding stop, where
+ * negative start and stop count from the end and a missing start or stop means the whole dimension in the step
+ * direction. An index selects a single element and drops the dimension.
+ */
+struct DimSlice {
+    std::optional<long> start;
+    std::optional<long> stop;
+    long step = 1;
+    bool index = false;
+};
+
+/**
+ * A reduction of the values of a leaf returned in place of the values
+ */
+enum class ReduceOp { None, Sum, Min, Max, Mean, Argmin, Argmax, Range };
+
+/**
+ * Options controlling how leaf arrays are copied into the returned data
+ */
+struct ReturnOptions {
+    // Return rank-N arrays in Fortran (column-major) element order with the shape reversed
+    bool fortran_order = false;
+    // Slices of the leading dimensions of the leaf, the remaining dimensions are returned whole
+    std::vector<DimSlice> slices;
+    // Return numeric leaves converted to this type (UDA_TYPE_FLOAT, UDA_TYPE_DOUBLE or UDA_TYPE_INT), or as
+    // stored for UDA_TYPE_UNKNOWN
+    UDA_TYPE dtype = UDA_TYPE_UNKNOWN;
+    // Describe the precision lost by a dtype conversion in the returned data description
+    bool report_loss = false;
+    // Return this reduction of the (sliced) leaf values rather than the values
+    ReduceOp op = ReduceOp::None;
+};
+
+/**
+ * Parse the name of a reduction: sum, min, max, mean, argmin, argmax or range
+ * @return 0 on success, 1 if the name is unknown
+ */
+int parse_reduce_op(std::string_view name, ReduceOp& op);
+
+/**
+ * Call visitor with a typed pointer to the leaf data and a null pointer of the type to return it as, ie. the
+ * requested dtype or else the leaf type. Strings are not visited and must be handled by the caller.
+ * @return 0 on success, 1 if the leaf type is not supported
+ */
+template <typename F> int visit_leaf_as(const GeometryLeaf& leaf, const ReturnOptions& options, F&& visitor) {
+    return visit_leaf(leaf, [&](auto* data) {
+        using T = std::remove_const_t<std::remove_pointer_t<decltype(data)>>;
+        switch (options.dtype) {
+            case UDA_TYPE_FLOAT:
+                visitor(data, static_cast<float*>(nullptr));
+                break;
+            case UDA_TYPE_DOUBLE:
+                visitor(data, static_cast<double*>(nullptr));
+                break;
+            case UDA_TYPE_INT:
+                visitor(data, static_cast<int*>(nullptr));
+                break;
+            default:
+                visitor(data, static_cast<T*>(nullptr));
+                break;
+        }
+    });
+}
+
+/**
+ * Describe the precision lost converting from one type to another, for the returned data description
+ */
+std::string describe_conversion(const imas_json_plugin::array_kernels::ConversionLoss& loss, UDA_TYPE from,
+                                UDA_TYPE to);
+
+/**
+ * Split the slice suffix off a key, eg. limiter.r[100:400:2] or grid[0][10:20]. The dimensions of a rank-N
+ * slice are given either as one bracket each or ',' separated in one bracket (which needs the key to be quoted
+ * as ',' also separates request arguments).
+ * @param leaf_key set to the key without its slice suffix
+ * @param slices set to the slices of the suffix, empty if there is none
+ * @return 0 on success, 1 if the slice suffix is malformed
+ */
+int split_key_slices(std::string_view key, std::string_view& leaf_key, std::vector<DimSlice>& slices);
+
+/**
+ * Resolve slices against an array shape.
+ * @param ranges set to the selected range of every dimension of the shape
+ * @param sliced_shape set to the shape of the selection, without the indexed dimensions
+ * @return 0 on success, 1 if there are more slices than dimensions or an index is out of range
+ */
+int resolve_slices(gsl::span<const DimSlice> slices, gsl::span<const size_t> shape,
+                   std::vector<imas_json_plugin::array_kernels::AxisRange>& ranges,
+                   std::vector<size_t>& sliced_shape);
+
+// Errors returned by copy_leaf
+constexpr int copy_leaf_slices_error = 1;
+constexpr int copy_leaf_alloc_error = 2;
+
+/**
+ * Copy an array leaf into a new malloc'd buffer of U, applying the return options. Only the sliced elements are
+ * copied, and they are converted to U as they are copied.
+ * @param out set to the copy on success, to be freed by the caller
+ * @param shape set to the shape of the returned array, empty if every dimension was indexed
+ * @param loss if not null, accumulates the precision lost converting to U (at the cost of an extra pass)
+ * @return 0 on success, copy_leaf_slices_error if the slices do not fit the leaf or copy_leaf_alloc_error if the
+ * copy could not be allocated
+ */
+template <typename U, typename T>
+int copy_leaf(const T* data, const GeometryLeaf& leaf, const ReturnOptions& options, U*& out,
+              std::vector<size_t>& shape, imas_json_plugin::array_kernels::ConversionLoss* loss = nullptr) {
+    namespace kernels = imas_json_plugin::array_kernels;
+
+    if constexpr (!std::is_same_v<T, U>) {
+        if (loss != nullptr) {
+            T* copy = nullptr;
+            if (int err = copy_leaf<T>(data, leaf, options, copy, shape)) {
+                return err;
+            }
+            size_t count = 1;
+            for (size_t dim : shape) {
+                count *= dim;
+            }
+            out = static_cast<U*>(malloc(std::max<size_t>(count, 1) * sizeof(U)));
+            if (out != nullptr) {
+                kernels::convert(copy, count, out, loss);
+            }
+            free(copy);
+            return out != nullptr ? 0 : copy_leaf_alloc_error;
+        }
+    }
+
+    if (options.slices.empty()) {
+        out = static_cast<U*>(malloc(std::max<size_t>(leaf.count(), 1) * sizeof(U)));
+        if (out == nullptr) {
+            return copy_leaf_alloc_error;
+        }
+        if (options.fortran_order && leaf.shape.size() > 1) {
+            kernels::reverse_axes(data, out, gsl::span<const size_t>{leaf.shape});
+            shape.assign(leaf.shape.rbegin(), leaf.shape.rend());
+        } else {
+            kernels::convert(data, leaf.count(), out);
+            shape = leaf.shape;
+        }
+        return 0;
+    }
+
+    std::vector<kernels::AxisRange> ranges;
+    std::vector<size_t> sliced_shape;
+    if (resolve_slices(options.slices, leaf.shape, ranges, sliced_shape)) {
+        return copy_leaf_slices_error;
+    }
+    size_t count = 1;
+    for (size_t dim : sliced_shape) {
+        count *= dim;
+    }
+
+    out = static_cast<U*>(malloc(std::max<size_t>(count, 1) * sizeof(U)));
+    if (out == nullptr) {
+        return copy_leaf_alloc_error;
+    }
+    if (options.fortran_order && sliced_shape.size() > 1) {
+        std::vector<T> sliced(count);
+        kernels::copy_ranges(data, sliced.data(), gsl::span<const size_t>{leaf.shape},
+                             gsl::span<const kernels::AxisRange>{ranges});
+        kernels::reverse_axes(sliced.data(), out, gsl::span<const size_t>{sliced_shape});
+        shape.assign(sliced_shape.rbegin(), sliced_shape.rend());
+    } else {
+        kernels::copy_ranges(data, out, gsl::span<const size_t>{leaf.shape},
+                             gsl::span<const kernels::AxisRange>{ranges});
+        shape = std::move(sliced_shape);
+    }
+    return 0;
+}
+
+/**
+ * Reduce count values, calling visitor with a span holding the result: the sum (long long for integer values,
+ * else double), the minimum or maximum (of the value type), the mean (double), the row-major index of the
+ * first minimum or maximum (long long), or the range as the pair minimum, maximum. NaN values propagate to
+ * sum and mean and are skipped by the other reductions.
+ * @return 0 on success, 1 if there are no values (or only NaN) to reduce
+ */
+template <typename T, typename F> int reduce_values(const T* values, size_t count, ReduceOp op, F&& visitor) {
+    namespace kernels = imas_json_plugin::array_kernels;
+
+    if (op == ReduceOp::Sum || op == ReduceOp::Mean) {
+        if (count == 0 && op == ReduceOp::Mean) {
+            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::reduce_values: No values to reduce\n");
+            return 1;
+        }
+        auto total = kernels::sum(values, count);
+        if (op == ReduceOp::Sum) {
+            visitor(gsl::span<const decltype(total)>{&total, 1});
+        } else {
+            double mean = static_cast<double>(total) / static_cast<double>(count);
+            visitor(gsl::span<const double>{&mean, 1});
+        }
+        return 0;
+    }
+
+    auto [lo, hi] = kernels::min_max(values, count);
+    if (count == 0 || hi < lo) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::reduce_values: No values to reduce\n");
+        return 1;
+    }
+    switch (op) {
+        case ReduceOp::Min:
+            visitor(gsl::span<const T>{&lo, 1});
+            break;
+        case ReduceOp::Max:
+            visitor(gsl::span<const T>{&hi, 1});
+            break;
+        case ReduceOp::Argmin:
+        case ReduceOp::Argmax: {
+            const T target = op == ReduceOp::Argmin ? lo : hi;
+            auto index = static_cast<long long>(std::find(values, values + count, target) - values);
+            visitor(gsl::span<const long long>{&index, 1});
+            break;
+        }
+        default: {
+            const T range[] = {lo, hi};
+            visitor(gsl::span<const T>{range});
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Reduce the values of a numeric leaf as set by options.op, after slicing them, and call visitor with the
+ * result (see reduce_values). Indices refer to the row-major order of the sliced leaf whatever the return order.
+ * @return 0 on success, copy_leaf_alloc_error if the sliced values could not be allocated, 1 if the leaf is a
+ * string, the slices do not fit the leaf or there is nothing to reduce
+ */
+template <typename F> int reduce_leaf(const GeometryLeaf& leaf, const ReturnOptions& options, F&& visitor) {
+    if (leaf.type == UDA_TYPE_STRING) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::reduce_leaf: Strings can not be reduced\n");
+        return 1;
+    }
+
+    int err = 0;
+    int type_err = visit_leaf(leaf, [&](auto* data) {
+        using T = std::remove_const_t<std::remove_pointer_t<decltype(data)>>;
+        if (options.slices.empty()) {
+            err = reduce_values(data, leaf.count(), options.op, visitor);
+            return;
+        }
+
+        ReturnOptions gather;
+        gather.slices = options.slices;
+        std::vector<size_t> shape;
+        T* values = nullptr;
+        err = leaf.rank > 0 ? copy_leaf<T>(data, leaf, gather, values, shape) : copy_leaf_slices_error;
+        if (err) {
+            return;
+        }
+        size_t count = 1;
+        for (size_t dim : shape) {
+            count *= dim;
+        }
+        err = reduce_values(values, count, options.op, visitor);
+        free(values);
+    });
+    return type_err ? type_err : err;
+}
+
+/**
+ * Set a single leaf as the return data: strings as a string, rank 0 leaves as a scalar and arrays as a copy
+ * of the (sliced) leaf data, converted to the requested dtype, or else the requested reduction of the leaf
+ * @return 0 on success, 1 if the leaf type is not supported or the slices do not fit the leaf, or the error
+ * raised if the returned data could not be allocated
+ */
+int set_return_data(DATA_BLOCK* data_block, const GeometryLeaf& leaf, const ReturnOptions& options);
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_RETURN_H
@@ -0,0 +1,51 @@
+#ifndef GEOMETRY_MAP_READER_SOURCE_H
+#define GEOMETRY_MAP_READER_SOURCE_H
+
+#include <optional>
+#include <vector>
+
+#include "geometry_cache.h"
+#include "gsl/gsl-lite.hpp"
+
+namespace geometry_map_reader {
+
+/**
+ * A source of geometry trees, eg. a GEOM server reached through UDA (UdaGeometrySource) or trees held in memory
+ * (MemoryGeometrySource). A source fetches the tree of a signal and indexes it with GeometryIndex::build over
+ * its own node handle type; the returned entry keeps whatever backs the leaf data alive.
+ */
+class GeometrySource {
+  public:
+    virtual ~GeometrySource() = default;
+
+    /**
+     * Fetch and index the tree of key.signal. The host and port of the key are only used by remote sources.
+     * @return 0 on success, non-zero if the tree could not be fetched
+     */
+    virtual int fetch(const GeometryCacheKey& key, std::optional<GeometryCacheEntry>& entry) = 0;
+
+    /**
+     * Fetch the trees of several signals from one endpoint, ie. keys differing only in their signal. Sources
+     * with a cheaper batched request override this.
+     * @param entries set to one entry per key, empty where the fetch failed
+     */
+    virtual void fetch_batch(gsl::span<const GeometryCacheKey> keys,
+                             std::vector<std::optional<GeometryCacheEntry>>& entries) {
+        entries.clear();
+        entries.resize(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (fetch(keys[i], entries[i])) {
+                entries[i].reset();
+            }
+        }
+    }
+
+    /**
+     * Release any connections and fetched data held by the source
+     */
+    virtual void clear() {}
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_SOURCE_H
@@ -0,0 +1,291 @@
+#include "geometry_source_file.h"
+
+#include <plugins/udaPlugin.h>
+
+#ifdef GEOMETRY_MAP_READER_HAVE_HDF5
+#  include <hdf5.h>
+
+#  include <cstring>
+#  include <memory>
+#  include <string>
+#  include <string_view>
+#  include <unistd.h>
+#  include <vector>
+
+#  include "geometry_source_memory.h"
+#endif
+
+namespace geometry_map_reader {
+
+#ifdef GEOMETRY_MAP_READER_HAVE_HDF5
+
+namespace {
+
+/**
+ * Closes an HDF5 identifier when it goes out of scope
+ */
+class H5Handle {
+  public:
+    H5Handle(hid_t id, herr_t (*close)(hid_t)) : id_{id}, close_{close} {}
+    ~H5Handle() {
+        if (id_ >= 0) {
+            close_(id_);
+        }
+    }
+    H5Handle(const H5Handle&) = delete;
+    H5Handle& operator=(const H5Handle&) = delete;
+
+    operator hid_t() const { return id_; }
+    [[nodiscard]] bool valid() const { return id_ >= 0; }
+
+  private:
+    hid_t id_;
+    herr_t (*close_)(hid_t);
+};
+
+/**
+ * @return the UDA type of a native HDF5 integer or float type, UDA_TYPE_UNKNOWN for any other type
+ */
+UDA_TYPE native_uda_type(hid_t type) {
+    size_t size = H5Tget_size(type);
+    switch (H5Tget_class(type)) {
+        case H5T_FLOAT:
+            return size == sizeof(float) ? UDA_TYPE_FLOAT : size == sizeof(double) ? UDA_TYPE_DOUBLE : UDA_TYPE_UNKNOWN;
+        case H5T_INTEGER: {
+            bool is_signed = H5Tget_sign(type) == H5T_SGN_2;
+            switch (size) {
+                case 1:
+                    return is_signed ? UDA_TYPE_CHAR : UDA_TYPE_UNSIGNED_CHAR;
+                case 2:
+                    return is_signed ? UDA_TYPE_SHORT : UDA_TYPE_UNSIGNED_SHORT;
+                case 4:
+                    return is_signed ? UDA_TYPE_INT : UDA_TYPE_UNSIGNED_INT;
+                case 8:
+                    return is_signed ? UDA_TYPE_LONG64 : UDA_TYPE_UNSIGNED_LONG64;
+                default:
+                    return UDA_TYPE_UNKNOWN;
+            }
+        }
+        default:
+            return UDA_TYPE_UNKNOWN;
+    }
+}
+
+/**
+ * Add a dataset or attribute of the given file type and dataspace to node as an atomic, where read(mem_type,
+ * buffer) reads the whole dataset or attribute. Strings must be scalar. Unsupported types are skipped.
+ * @return 0 on success, non-zero if the read fails
+ */
+template <typename Read>
+int add_atomic(MemoryTreeNode& node, std::string name, hid_t file_type, hid_t space, Read&& read) {
+    int rank = H5Sget_simple_extent_ndims(space);
+    if (rank < 0) {
+        return 1;
+    }
+    std::vector<hsize_t> dims(rank);
+    H5Sget_simple_extent_dims(space, dims.data(), nullptr);
+    std::vector<size_t> shape(dims.begin(), dims.end());
+    size_t count = H5Sget_simple_extent_npoints(space);
+
+    if (H5Tget_class(file_type) == H5T_STRING) {
+        if (count != 1) {
+            UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::add_atomic: Skipping string array %s\n",
+                    name.c_str());
+            return 0;
+        }
+        H5Handle mem_type{H5Tcopy(H5T_C_S1), H5Tclose};
+        if (H5Tis_variable_str(file_type) > 0) {
+            H5Tset_size(mem_type, H5T_VARIABLE);
+            char* value = nullptr;
+            if (read(mem_type, &value) < 0) {
+                return 1;
+            }
+            size_t length = value != nullptr ? std::strlen(value) : 0;
+            std::memcpy(node.add_atomic(std::move(name), UDA_TYPE_STRING, {}, length + 1), value, length);
+            H5free_memory(value);
+        } else {
+            size_t length = H5Tget_size(file_type);
+            H5Tset_size(mem_type, length);
+            H5Tset_strpad(mem_type, H5T_STR_NULLPAD);
+            // The extra zeroed byte terminates strings filling their fixed length
+            void* buffer = node.add_atomic(std::move(name), UDA_TYPE_STRING, {}, length + 1);
+            if (read(mem_type, buffer) < 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    H5Handle mem_type{H5Tget_native_type(file_type, H5T_DIR_ASCEND), H5Tclose};
+    UDA_TYPE type = mem_type.valid() ? native_uda_type(mem_type) : UDA_TYPE_UNKNOWN;
+    if (type == UDA_TYPE_UNKNOWN) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::add_atomic: Skipping unsupported type of %s\n",
+                name.c_str());
+        return 0;
+    }
+    void* buffer = node.add_atomic(std::move(name), type, std::move(shape), count * H5Tget_size(mem_type));
+    return read(mem_type, buffer) < 0 ? 1 : 0;
+}
+
+/**
+ * @return true for the attributes HDF5 dimension scales and netCDF-4 add to describe dimensions
+ */
+bool is_bookkeeping_attribute(std::string_view name) {
+    return name.empty() || name[0] == '_' || name == "CLASS" || name == "NAME" || name == "DIMENSION_LIST" ||
+           name == "REFERENCE_LIST";
+}
+
+/**
+ * @return true for the datasets netCDF-4 writes for dimensions that have no coordinate variable
+ */
+bool is_dimension_only(hid_t dataset) {
+    if (H5Aexists(dataset, "NAME") <= 0) {
+        return false;
+    }
+    H5Handle attribute{H5Aopen(dataset, "NAME", H5P_DEFAULT), H5Aclose};
+    H5Handle type{H5Aget_type(attribute), H5Tclose};
+    if (H5Tget_class(type) != H5T_STRING || H5Tis_variable_str(type) > 0) {
+        return false;
+    }
+    std::vector<char> name(H5Tget_size(type) + 1, '\0');
+    if (H5Aread(attribute, type, name.data()) < 0) {
+        return false;
+    }
+    return std::string_view{name.data()}.rfind("This is a netCDF dimension but not a netCDF variable", 0) == 0;
+}
+
+herr_t collect_attribute_name(hid_t, const char* name, const H5A_info_t*, void* names) {
+    static_cast<std::vector<std::string>*>(names)->emplace_back(name);
+    return 0;
+}
+
+int add_attributes(hid_t object, MemoryTreeNode& node) {
+    std::vector<std::string> names;
+    if (H5Aiterate2(object, H5_INDEX_NAME, H5_ITER_INC, nullptr, collect_attribute_name, &names) < 0) {
+        return 1;
+    }
+    for (auto& name : names) {
+        if (is_bookkeeping_attribute(name)) {
+            continue;
+        }
+        H5Handle attribute{H5Aopen(object, name.c_str(), H5P_DEFAULT), H5Aclose};
+        H5Handle type{H5Aget_type(attribute), H5Tclose};
+        H5Handle space{H5Aget_space(attribute), H5Sclose};
+        if (!attribute.valid() || !type.valid() || !space.valid()) {
+            return 1;
+        }
+        int err = add_atomic(node, std::move(name), type, space,
+                             [&](hid_t mem_type, void* buffer) { return H5Aread(attribute, mem_type, buffer); });
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read a group into node: its datasets and attributes become atomics and its groups child nodes, in name order
+ */
+int read_group(hid_t group, MemoryTreeNode& node) {
+    H5G_info_t info;
+    if (H5Gget_info(group, &info) < 0) {
+        return 1;
+    }
+
+    std::vector<std::string> groups;
+    for (hsize_t i = 0; i < info.nlinks; ++i) {
+        ssize_t length = H5Lget_name_by_idx(group, ".", H5_INDEX_NAME, H5_ITER_INC, i, nullptr, 0, H5P_DEFAULT);
+        if (length < 0) {
+            return 1;
+        }
+        std::string name(static_cast<size_t>(length), '\0');
+        H5Lget_name_by_idx(group, ".", H5_INDEX_NAME, H5_ITER_INC, i, name.data(), name.size() + 1, H5P_DEFAULT);
+
+        H5Handle object{H5Oopen(group, name.c_str(), H5P_DEFAULT), H5Oclose};
+        if (!object.valid()) {
+            return 1;
+        }
+        H5I_type_t type = H5Iget_type(object);
+        if (type == H5I_GROUP) {
+            groups.push_back(std::move(name));
+        } else if (type == H5I_DATASET && !is_dimension_only(object)) {
+            H5Handle file_type{H5Dget_type(object), H5Tclose};
+            H5Handle space{H5Dget_space(object), H5Sclose};
+            if (!file_type.valid() || !space.valid()) {
+                return 1;
+            }
+            int err = add_atomic(node, std::move(name), file_type, space, [&](hid_t mem_type, void* buffer) {
+                return H5Dread(object, mem_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer);
+            });
+            if (err) {
+                return err;
+            }
+        }
+    }
+
+    if (int err = add_attributes(group, node)) {
+        return err;
+    }
+
+    for (auto& name : groups) {
+        H5Handle child{H5Gopen2(group, name.c_str(), H5P_DEFAULT), H5Gclose};
+        if (!child.valid()) {
+            return 1;
+        }
+        if (int err = read_group(child, node.add_child(std::move(name)))) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int FileGeometrySource::fetch(const GeometryCacheKey& key, std::optional<GeometryCacheEntry>& entry) {
+    PhaseTimer timer{stats_};
+
+    if (key.signal.empty() || key.signal.find("..") != std::string::npos) {
+        RAISE_PLUGIN_ERROR("Signal is not a valid geometry file name");
+    }
+
+    std::string path;
+    for (const char* extension : {".h5", ".nc"}) {
+        path = directory_ + "/" + std::to_string(key.config) + (key.signal[0] == '/' ? "" : "/") + key.signal +
+               extension;
+        if (access(path.c_str(), R_OK) == 0) {
+            break;
+        }
+        path.clear();
+    }
+    if (path.empty()) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::fetch: No geometry file for %s in %s\n",
+                key.signal.c_str(), directory_.c_str());
+        RAISE_PLUGIN_ERROR("Geometry file not found");
+    }
+
+    H5Handle file{H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose};
+    if (!file.valid()) {
+        RAISE_PLUGIN_ERROR("Unable to open geometry file");
+    }
+    H5Handle root{H5Gopen2(file, "/", H5P_DEFAULT), H5Gclose};
+    auto tree = std::make_shared<MemoryTreeNode>("data");
+    if (!root.valid() || read_group(root, *tree)) {
+        RAISE_PLUGIN_ERROR("Unable to read geometry file");
+    }
+    timer.lap(Phase::Fetch);
+
+    auto index = std::make_shared<const GeometryIndex>(GeometryIndex::build(MemoryTreeRef{*tree}));
+    timer.lap(Phase::IndexBuild);
+    entry.emplace(GeometryCacheEntry{index, std::move(tree), index->bytes()});
+    return 0;
+}
+
+#else
+
+int FileGeometrySource::fetch(const GeometryCacheKey&, std::optional<GeometryCacheEntry>&) {
+    RAISE_PLUGIN_ERROR("The file backend needs the plugin to be built with GEOMETRY_MAP_READER_HDF5");
+}
+
+#endif
+
+} // namespace geometry_map_reader
@@ -0,0 +1,37 @@
+#ifndef GEOMETRY_MAP_READER_SOURCE_FILE_H
+#define GEOMETRY_MAP_READER_SOURCE_FILE_H
+
+#include <string>
+
+#include "geometry_source.h"
+#include "geometry_stats.h"
+
+namespace geometry_map_reader {
+
+/**
+ * Reads geometry trees directly from HDF5 geometry files (including netCDF-4 files, which are HDF5 files),
+ * bypassing the GEOM server. The tree of a signal is read from <directory>/<config>/<signal>.h5 (or .nc), eg.
+ * /data/geometry/1/magnetics/pfcoil/d1_upper.h5 for signal /magnetics/pfcoil/d1_upper and config 1.
+ *
+ * The root group of the file is the data node of the GEOM tree: groups are nodes, and datasets and attributes
+ * are atomics, so keys resolve as they do for GEOM::get trees. netCDF dimension bookkeeping (dimension-only
+ * datasets and the attributes netCDF and HDF5 dimension scales add) is skipped. Files are not per GEOM server
+ * or source (shot), so the plugin fetches every tree with an empty host, port 0 and source 0.
+ *
+ * Only available if the plugin is built with GEOMETRY_MAP_READER_HDF5, otherwise fetching fails.
+ */
+class FileGeometrySource final : public GeometrySource {
+  public:
+    FileGeometrySource(PluginStats& stats, std::string directory)
+        : stats_{stats}, directory_{std::move(directory)} {}
+
+    int fetch(const GeometryCacheKey& key, std::optional<GeometryCacheEntry>& entry) override;
+
+  private:
+    PluginStats& stats_;
+    std::string directory_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_SOURCE_FILE_H
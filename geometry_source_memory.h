@@ -0,0 +1,158 @@
+#ifndef GEOMETRY_MAP_READER_SOURCE_MEMORY_H
+#define GEOMETRY_MAP_READER_SOURCE_MEMORY_H
+
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "geometry_index.h"
+#include "geometry_source.h"
+#include "geometry_stats.h"
+#include "utils/uda_plugin_helpers.hpp"
+
+namespace geometry_map_reader {
+
+/**
+ * A geometry tree node held in memory. The node owns the data of its atomics, which stays in place when the
+ * node is moved.
+ */
+struct MemoryTreeNode {
+    explicit MemoryTreeNode(std::string name) : name{std::move(name)} {}
+    MemoryTreeNode(const MemoryTreeNode&) = delete;
+    MemoryTreeNode& operator=(const MemoryTreeNode&) = delete;
+    MemoryTreeNode(MemoryTreeNode&&) = default;
+    MemoryTreeNode& operator=(MemoryTreeNode&&) = default;
+
+    /**
+     * @return the new child, valid until the next child is added to this node
+     */
+    MemoryTreeNode& add_child(std::string child_name) { return children.emplace_back(std::move(child_name)); }
+
+    /**
+     * Add an atomic of the given type and shape (empty for a scalar) backed by a zeroed buffer owned by the node
+     * @return the buffer of bytes bytes, for the caller to fill
+     */
+    void* add_atomic(std::string atomic_name, UDA_TYPE type, std::vector<size_t> shape, size_t bytes) {
+        auto& buffer = buffers.emplace_back(bytes);
+        size_t rank = shape.size();
+        atomics.emplace_back(std::move(atomic_name), GeometryLeaf{type, rank, std::move(shape), buffer.data()});
+        return buffer.data();
+    }
+
+    template <typename T>
+    void add_array(std::string atomic_name, gsl::span<const T> values, std::vector<size_t> shape) {
+        void* data = add_atomic(std::move(atomic_name), imas_json_plugin::uda_helpers::uda_type_v<T>,
+                                std::move(shape), values.size() * sizeof(T));
+        if (!values.empty()) {
+            std::memcpy(data, values.data(), values.size() * sizeof(T));
+        }
+    }
+
+    template <typename T> void add_scalar(std::string atomic_name, T value) {
+        void* data = add_atomic(std::move(atomic_name), imas_json_plugin::uda_helpers::uda_type_v<T>, {}, sizeof(T));
+        std::memcpy(data, &value, sizeof(T));
+    }
+
+    void add_string(std::string atomic_name, std::string_view value) {
+        void* data = add_atomic(std::move(atomic_name), UDA_TYPE_STRING, {}, value.size() + 1);
+        if (!value.empty()) {
+            std::memcpy(data, value.data(), value.size());
+        }
+    }
+
+    std::string name;
+    std::vector<MemoryTreeNode> children;
+    std::vector<std::pair<std::string, GeometryLeaf>> atomics;
+
+  private:
+    std::deque<std::vector<char>> buffers;
+};
+
+/**
+ * Node handle over a MemoryTreeNode for GeometryIndex::build
+ */
+class MemoryTreeRef {
+  public:
+    explicit MemoryTreeRef(const MemoryTreeNode& node) : node_{&node} {}
+
+    [[nodiscard]] std::string name() const { return node_->name; }
+
+    [[nodiscard]] std::vector<MemoryTreeRef> children() const {
+        return {node_->children.begin(), node_->children.end()};
+    }
+
+    template <typename F> void for_each_atomic(F&& f) const {
+        for (const auto& [name, leaf] : node_->atomics) {
+            f(std::string_view{name}, leaf);
+        }
+    }
+
+  private:
+    const MemoryTreeNode* node_;
+};
+
+/**
+ * Copy a tree into memory owned by copy, eg. so that the result a tree was fetched in can be released. Node is a
+ * node handle as taken by GeometryIndex::build.
+ */
+template <typename Node> void copy_tree(const Node& node, MemoryTreeNode& copy) {
+    node.for_each_atomic([&](std::string_view name, const GeometryLeaf& leaf) {
+        size_t bytes = leaf.count() * uda_type_size(leaf.type);
+        if (leaf.type == UDA_TYPE_STRING) {
+            bytes = leaf.data != nullptr ? std::strlen(static_cast<const char*>(leaf.data)) + 1 : 0;
+        }
+        void* data = copy.add_atomic(std::string{name}, leaf.type, leaf.shape, bytes);
+        if (leaf.data != nullptr && bytes > 0) {
+            std::memcpy(data, leaf.data, bytes);
+        }
+        // Keep the rank of the source, which may differ from the shape size for scalars
+        copy.atomics.back().second.rank = leaf.rank;
+    });
+    for (const Node& child : node.children()) {
+        copy_tree(child, copy.add_child(child.name()));
+    }
+}
+
+/**
+ * Serves trees held in memory, keyed by source, signal and configuration, eg. synthetic trees for tests and
+ * benchmarks. The host and port of requests are ignored.
+ */
+class MemoryGeometrySource final : public GeometrySource {
+  public:
+    explicit MemoryGeometrySource(PluginStats& stats) : stats_{stats} {}
+
+    /**
+     * Serve tree for source, signal (lowercase, as requested by GEOMETRY) and config, replacing any previous tree
+     */
+    void add(int source, const std::string& signal, int config, std::shared_ptr<const MemoryTreeNode> tree) {
+        trees_[{source, signal, config}] = std::move(tree);
+    }
+
+    int fetch(const GeometryCacheKey& key, std::optional<GeometryCacheEntry>& entry) override {
+        PhaseTimer timer{stats_};
+        auto found = trees_.find({key.source, key.signal, key.config});
+        if (found == trees_.end()) {
+            return 1;
+        }
+        auto index = std::make_shared<const GeometryIndex>(GeometryIndex::build(MemoryTreeRef{*found->second}));
+        timer.lap(Phase::IndexBuild);
+        entry.emplace(GeometryCacheEntry{index, found->second, index->bytes()});
+        return 0;
+    }
+
+    void clear() override { trees_.clear(); }
+
+  private:
+    PluginStats& stats_;
+    std::map<std::tuple<int, std::string, int>, std::shared_ptr<const MemoryTreeNode>> trees_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_SOURCE_MEMORY_H
@@ -0,0 +1,108 @@
+#include "geometry_source_uda.h"
+
+#include <fmt/format.h>
+#include <plugins/udaPlugin.h>
+
+#include <memory>
+
+#include "geometry_source_memory.h"
+
+namespace geometry_map_reader {
+
+namespace {
+
+int tree_check(uda::TreeNode& temp_tree) {
+
+    if (!temp_tree.numChildren()) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::tree_check: No children found\n");
+        return 1;
+    }
+    if (temp_tree.child(0).name() != "data") {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::tree_check: No child named data\n");
+        return 1;
+    }
+    return 0;
+};
+
+std::string geom_request(const std::string& signal, int config) {
+    // eg. GEOM::get(signal=/magnetics/pfcoil/d1_upper, Config=1);
+    return fmt::format("GEOM::get(signal={}, Config={})", signal, config);
+}
+
+} // namespace
+
+int UdaGeometrySource::load_tree(const uda::Result& data, std::optional<GeometryCacheEntry>& entry) {
+
+    PhaseTimer timer{stats_};
+
+    // Check for errors
+    if (data.errorCode() != uda::OK) {
+        RAISE_PLUGIN_ERROR("uda::Result data is not uda::OK");
+    }
+
+    // Check this returned data is a structure: Set (register) the data tree for accessors
+    if (!data.isTree()) {
+        RAISE_PLUGIN_ERROR("Returned data is not of expected tree structure");
+    }
+
+    uda::TreeNode root_tree = data.tree();
+    // Hack to skip two levels
+    if (!tree_check(root_tree)) {
+        root_tree = root_tree.child(0);
+    }
+    if (!tree_check(root_tree)) {
+        root_tree = root_tree.child(0);
+    }
+    timer.lap(Phase::TreeCheck);
+
+    // Copy the tree out of the result so the result can be released and the cache bounds the memory held
+    auto tree = std::make_shared<MemoryTreeNode>("data");
+    copy_tree(UdaTreeNode{root_tree}, *tree);
+    auto index = std::make_shared<const GeometryIndex>(GeometryIndex::build(MemoryTreeRef{*tree}));
+    timer.lap(Phase::IndexBuild);
+    entry.emplace(GeometryCacheEntry{index, std::move(tree), index->bytes()});
+    return 0;
+}
+
+int UdaGeometrySource::fetch(const GeometryCacheKey& key, std::optional<GeometryCacheEntry>& entry) {
+    PhaseTimer timer{stats_};
+
+    uda::Client& client = [&]() -> uda::Client& {
+        TraceSpan span{stats_.trace(), "client_acquire", "pool"};
+        return clients_.acquire(key.host, key.port);
+    }();
+    // A batch of one: its results are owned by the returned list rather than the client, so they are freed once
+    // the tree is copied while the client is kept for the next request
+    uda::ResultList results = client.get_batch({geom_request(key.signal, key.config)}, std::to_string(key.source));
+    timer.lap(Phase::Fetch);
+
+    return load_tree(results.at(0), entry);
+}
+
+void UdaGeometrySource::fetch_batch(gsl::span<const GeometryCacheKey> keys,
+                                    std::vector<std::optional<GeometryCacheEntry>>& entries) {
+    entries.clear();
+    entries.resize(keys.size());
+    if (keys.empty()) {
+        return;
+    }
+
+    std::vector<std::string> requests;
+    for (const auto& key : keys) {
+        requests.push_back(geom_request(key.signal, key.config));
+    }
+
+    uda::Client& client = clients_.acquire(keys[0].host, keys[0].port);
+    uda::ResultList results = [&]() {
+        TraceSpan span{stats_.trace(), "get_batch", "worker"};
+        return client.get_batch(requests, std::to_string(keys[0].source));
+    }();
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i >= results.size() || load_tree(results.at(i), entries[i])) {
+            entries[i].reset();
+        }
+    }
+}
+
+} // namespace geometry_map_reader
@@ -0,0 +1,87 @@
+#ifndef GEOMETRY_MAP_READER_SOURCE_UDA_H
+#define GEOMETRY_MAP_READER_SOURCE_UDA_H
+
+#include <c++/UDA.hpp>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "geometry_client_pool.h"
+#include "geometry_index.h"
+#include "geometry_source.h"
+#include "geometry_stats.h"
+
+namespace geometry_map_reader {
+
+/**
+ * Node handle over a uda::TreeNode for GeometryIndex::build
+ */
+class UdaTreeNode {
+  public:
+    explicit UdaTreeNode(uda::TreeNode node) : node_{std::move(node)} {}
+
+    [[nodiscard]] std::string name() const { return node_.name(); }
+
+    [[nodiscard]] std::vector<UdaTreeNode> children() const {
+        std::vector<UdaTreeNode> children;
+        for (auto& child : node_.children()) {
+            children.emplace_back(std::move(child));
+        }
+        return children;
+    }
+
+    template <typename F> void for_each_atomic(F&& f) const {
+        std::vector<std::string> anames = node_.atomicNames();
+        std::vector<std::string> atypes = node_.atomicTypes();
+        std::vector<size_t> arank = node_.atomicRank();
+        std::vector<std::vector<size_t>> ashape = node_.atomicShape();
+
+        for (size_t idx = 0; idx < anames.size(); ++idx) {
+            f(std::string_view{anames[idx]}, GeometryLeaf{atomic_uda_type(atypes[idx]), arank[idx],
+                                                          std::move(ashape[idx]),
+                                                          node_.structureComponentData(anames[idx])});
+        }
+    }
+
+  private:
+    uda::TreeNode node_;
+};
+
+/**
+ * Fetches trees with GEOM::get requests to the GEOM server named in each key, through pooled UDA clients.
+ * Each fetched tree is copied into memory owned by its entry and its result is then freed, so a tree's memory is
+ * freed once its entry is evicted from the cache.
+ */
+class UdaGeometrySource final : public GeometrySource {
+  public:
+    explicit UdaGeometrySource(PluginStats& stats) : stats_{stats} {}
+
+    int fetch(const GeometryCacheKey& key, std::optional<GeometryCacheEntry>& entry) override;
+
+    /**
+     * Fetch the trees with the UDA batch API: one round trip for all of them, though the GEOM server reads them
+     * one after another
+     */
+    void fetch_batch(gsl::span<const GeometryCacheKey> keys,
+                     std::vector<std::optional<GeometryCacheEntry>>& entries) override;
+
+    void clear() override { clients_.clear(); }
+
+    [[nodiscard]] const ClientPool& clients() const { return clients_; }
+
+  private:
+    /**
+     * Check a GEOM::get result and build the cache entry for its tree
+     * @return 0 on success, non-zero if the result is an error or not a tree
+     */
+    int load_tree(const uda::Result& data, std::optional<GeometryCacheEntry>& entry);
+
+    PluginStats& stats_;
+    ClientPool clients_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_SOURCE_UDA_H
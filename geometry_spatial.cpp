@@ -0,0 +1,382 @@
+#include "geometry_spatial.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#include "geometry_return.h"
+
+namespace geometry_map_reader {
+
+namespace {
+
+bool is_numeric(const GeometryLeaf* leaf) {
+    return leaf != nullptr && leaf->type != UDA_TYPE_STRING && leaf->type != UDA_TYPE_UNKNOWN;
+}
+
+std::vector<double> leaf_values(const GeometryLeaf& leaf) {
+    std::vector<double> values(leaf.count());
+    visit_leaf(leaf, [&](auto* data) { imas_json_plugin::array_kernels::convert(data, values.size(), values.data()); });
+    return values;
+}
+
+/**
+ * Liang-Barsky clipping of the segment (r0, z0) - (r1, z1) against box
+ * @return true if any part of the segment is within the box
+ */
+bool segment_intersects(double r0, double z0, double r1, double z1, const Box& box) {
+    const double p[] = {r0 - r1, r1 - r0, z0 - z1, z1 - z0};
+    const double q[] = {r0 - box.rmin, box.rmax - r0, z0 - box.zmin, box.zmax - z0};
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int k = 0; k < 4; ++k) {
+        if (p[k] == 0.0) {
+            if (q[k] < 0.0) {
+                return false;
+            }
+            continue;
+        }
+        const double t = q[k] / p[k];
+        if (p[k] < 0.0) {
+            t0 = std::max(t0, t);
+        } else {
+            t1 = std::min(t1, t);
+        }
+        if (t0 > t1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @return the squared distance from (r, z) to the segment (r0, z0) - (r1, z1)
+ */
+double segment_distance2(double r, double z, double r0, double z0, double r1, double z1) {
+    const double dr = r1 - r0;
+    const double dz = z1 - z0;
+    const double length2 = dr * dr + dz * dz;
+    double t = length2 > 0.0 ? ((r - r0) * dr + (z - z0) * dz) / length2 : 0.0;
+    t = std::min(std::max(t, 0.0), 1.0);
+    const double offset_r = r0 + t * dr - r;
+    const double offset_z = z0 + t * dz - z;
+    return offset_r * offset_r + offset_z * offset_z;
+}
+
+} // namespace
+
+PackedRTree::PackedRTree(const std::vector<Box>& boxes, size_t node_size) : node_size_{std::max<size_t>(node_size, 2)} {
+    const size_t count = boxes.size();
+    if (count == 0) {
+        return;
+    }
+
+    // Sort-tile-recursive order: sqrt(leaves) vertical slices sorted by R centre, each sorted by Z centre
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    auto r_centre = [&](uint32_t i) { return boxes[i].rmin + boxes[i].rmax; };
+    auto z_centre = [&](uint32_t i) { return boxes[i].zmin + boxes[i].zmax; };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return r_centre(a) < r_centre(b); });
+    const size_t leaves = (count + node_size_ - 1) / node_size_;
+    const auto slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+    const size_t slice_size = slices * node_size_;
+    for (size_t first = 0; first < count; first += slice_size) {
+        std::sort(order.begin() + first, order.begin() + std::min(first + slice_size, count),
+                  [&](uint32_t a, uint32_t b) { return z_centre(a) < z_centre(b); });
+    }
+
+    boxes_.reserve(count + count / (node_size_ - 1) + 1);
+    indices_.reserve(boxes_.capacity());
+    for (uint32_t item : order) {
+        boxes_.push_back(boxes[item]);
+        indices_.push_back(item);
+    }
+    level_ends_.push_back(count);
+
+    // Each level groups consecutive runs of node_size boxes of the level below
+    size_t begin = 0;
+    size_t end = count;
+    while (end - begin > 1) {
+        for (size_t first = begin; first < end; first += node_size_) {
+            Box box;
+            for (size_t i = first; i < std::min(first + node_size_, end); ++i) {
+                box.expand(boxes_[i]);
+            }
+            boxes_.push_back(box);
+            indices_.push_back(static_cast<uint32_t>(first));
+        }
+        begin = end;
+        end = boxes_.size();
+        level_ends_.push_back(end);
+    }
+}
+
+KdTree::KdTree(std::vector<Point> points) : points_{std::move(points)}, split_r_(points_.size(), false) {
+    build(0, points_.size());
+}
+
+void KdTree::build(size_t begin, size_t end) {
+    while (end - begin > 1) {
+        double rmin = points_[begin].r;
+        double rmax = rmin;
+        double zmin = points_[begin].z;
+        double zmax = zmin;
+        for (size_t i = begin + 1; i < end; ++i) {
+            rmin = std::min(rmin, points_[i].r);
+            rmax = std::max(rmax, points_[i].r);
+            zmin = std::min(zmin, points_[i].z);
+            zmax = std::max(zmax, points_[i].z);
+        }
+        const bool split_r = rmax - rmin >= zmax - zmin;
+
+        const size_t middle = begin + (end - begin) / 2;
+        std::nth_element(points_.begin() + begin, points_.begin() + middle, points_.begin() + end,
+                         [&](const Point& a, const Point& b) { return split_r ? a.r < b.r : a.z < b.z; });
+        split_r_[middle] = split_r;
+
+        build(begin, middle);
+        begin = middle + 1;
+    }
+}
+
+void ContourSet::add(const std::vector<double>& r, const std::vector<double>& z) {
+    const size_t points = std::min(r.size(), z.size());
+    if (points < 2) {
+        return;
+    }
+    for (size_t i = 0; i < points; ++i) {
+        const size_t next = i + 1 == points ? 0 : i + 1;
+        edges_.push_back({r[i], z[i], r[next], z[next]});
+        bounds_.expand({r[i], r[i], z[i], z[i]});
+    }
+    ++contours_;
+}
+
+void ContourSet::build() {
+    band_ends_.clear();
+    r0_.clear();
+    z0_.clear();
+    z1_.clear();
+    slope_.clear();
+    edge_tree_ = PackedRTree{};
+    if (edges_.empty()) {
+        return;
+    }
+
+    // About one band per edge, halved while long edges copied into many bands would more than quadruple the edges
+    const double height = bounds_.zmax - bounds_.zmin;
+    size_t bands = height > 0.0 ? std::min<size_t>(edges_.size(), max_bands) : 1;
+    std::vector<std::pair<size_t, size_t>> spans(edges_.size());
+    size_t entries = 0;
+    while (true) {
+        band_scale_ = height > 0.0 ? static_cast<double>(bands) / height : 0.0;
+        band_ends_.assign(bands, 0);
+        entries = 0;
+        for (size_t i = 0; i < edges_.size(); ++i) {
+            const Edge& edge = edges_[i];
+            spans[i] = {band(std::min(edge.z0, edge.z1)), band(std::max(edge.z0, edge.z1))};
+            entries += spans[i].second - spans[i].first + 1;
+        }
+        if (bands == 1 || entries <= 4 * edges_.size()) {
+            break;
+        }
+        bands /= 2;
+    }
+
+    // Count the edges of each band, then place them in band order
+    for (const auto& [first, last] : spans) {
+        for (size_t b = first; b <= last; ++b) {
+            ++band_ends_[b];
+        }
+    }
+    std::partial_sum(band_ends_.begin(), band_ends_.end(), band_ends_.begin());
+    std::vector<size_t> next(bands, 0);
+    std::copy(band_ends_.begin(), band_ends_.end() - 1, next.begin() + 1);
+    for (auto* values : {&r0_, &z0_, &z1_, &slope_}) {
+        values->resize(entries);
+    }
+    for (size_t i = 0; i < edges_.size(); ++i) {
+        const Edge& edge = edges_[i];
+        const double dz = edge.z1 - edge.z0;
+        for (size_t b = spans[i].first; b <= spans[i].second; ++b) {
+            const size_t position = next[b]++;
+            r0_[position] = edge.r0;
+            z0_[position] = edge.z0;
+            z1_[position] = edge.z1;
+            slope_[position] = dz != 0.0 ? (edge.r1 - edge.r0) / dz : 0.0;
+        }
+    }
+
+    std::vector<Box> boxes;
+    boxes.reserve(edges_.size());
+    for (const Edge& edge : edges_) {
+        boxes.push_back({std::min(edge.r0, edge.r1), std::max(edge.r0, edge.r1), std::min(edge.z0, edge.z1),
+                         std::max(edge.z0, edge.z1)});
+    }
+    edge_tree_ = PackedRTree{boxes};
+}
+
+unsigned int ContourSet::crossings(size_t band, double r, double z) const {
+    const size_t begin = band == 0 ? 0 : band_ends_[band - 1];
+    const size_t end = band_ends_[band];
+    const double* r0 = r0_.data();
+    const double* z0 = z0_.data();
+    const double* z1 = z1_.data();
+    const double* slope = slope_.data();
+    unsigned int count = 0;
+    for (size_t i = begin; i < end; ++i) {
+        // The edge spans z, counting its lower end but not its upper end, and crosses z right of r
+        const bool spans = (z0[i] > z) != (z1[i] > z);
+        const bool right = r < r0[i] + (z - z0[i]) * slope[i];
+        count += static_cast<unsigned int>(spans & right);
+    }
+    return count;
+}
+
+void ContourSet::inside(const double* r, const double* z, size_t count, unsigned char* mask) const {
+    for (size_t i = 0; i < count; ++i) {
+        const bool in_bounds = z[i] >= bounds_.zmin && z[i] <= bounds_.zmax && r[i] <= bounds_.rmax;
+        mask[i] = in_bounds && !band_ends_.empty() ? crossings(band(z[i]), r[i], z[i]) & 1U : 0;
+    }
+}
+
+void ContourSet::signed_distance(const double* r, const double* z, size_t count, const unsigned char* mask,
+                                 double* distance) const {
+    std::vector<PackedRTree::Candidate> heap;
+    for (size_t i = 0; i < count; ++i) {
+        const double point_r = r[i];
+        const double point_z = z[i];
+        auto edge_distance = [&](size_t edge) {
+            return segment_distance2(point_r, point_z, edges_[edge].r0, edges_[edge].z0, edges_[edge].r1,
+                                     edges_[edge].z1);
+        };
+        const bool valid = !edges_.empty() && !std::isnan(point_r) && !std::isnan(point_z);
+        const double nearest = valid ? std::sqrt(edge_tree_.nearest(point_r, point_z, edge_distance, heap).first)
+                                     : std::numeric_limits<double>::quiet_NaN();
+        distance[i] = mask[i] ? -nearest : nearest;
+    }
+}
+
+void rasterise(const ContourSet& contours, const RasterGrid& grid, size_t threads, unsigned char* mask,
+               double* distance) {
+    std::vector<double> r(grid.nr);
+    for (size_t i = 0; i < grid.nr; ++i) {
+        r[i] = grid.r(i);
+    }
+
+    std::atomic<size_t> next_row{0};
+    auto work = [&]() {
+        std::vector<double> z(grid.nr);
+        for (size_t row = next_row++; row < grid.nz; row = next_row++) {
+            std::fill(z.begin(), z.end(), grid.z(row));
+            contours.inside(r.data(), z.data(), grid.nr, mask + row * grid.nr);
+            contours.signed_distance(r.data(), z.data(), grid.nr, mask + row * grid.nr, distance + row * grid.nr);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(threads, grid.nz); ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void GeometryElementSet::add_tree(std::string_view signal, const GeometryIndex& index) {
+    index.for_each_leaf([&](std::string_view key, const GeometryLeaf& r_leaf) {
+        auto dot = key.rfind('.');
+        std::string_view name = dot == std::string_view::npos ? key : key.substr(dot + 1);
+        if (name != "r" || !is_numeric(&r_leaf) || r_leaf.count() == 0) {
+            return;
+        }
+        std::string path{dot == std::string_view::npos ? std::string_view{} : key.substr(0, dot)};
+        auto sibling = [&](const char* sibling_name) -> const GeometryLeaf* {
+            const GeometryLeaf* leaf = index.find(path.empty() ? sibling_name : path + "." + sibling_name);
+            return is_numeric(leaf) && leaf->count() == r_leaf.count() ? leaf : nullptr;
+        };
+
+        const GeometryLeaf* z_leaf = sibling("z");
+        if (z_leaf == nullptr) {
+            return;
+        }
+        const GeometryLeaf* dr_leaf = sibling("dr");
+        const GeometryLeaf* dz_leaf = sibling("dz");
+        GeometryElement element;
+        element.signal = signal;
+        element.path = std::move(path);
+        element.r = leaf_values(r_leaf);
+        element.z = leaf_values(*z_leaf);
+        if (dr_leaf != nullptr && dz_leaf != nullptr) {
+            element.dr = leaf_values(*dr_leaf);
+            element.dz = leaf_values(*dz_leaf);
+        }
+        elements_.push_back(std::move(element));
+    });
+}
+
+void GeometryElementSet::build() {
+    parts_.clear();
+    std::vector<Box> boxes;
+
+    for (size_t e = 0; e < elements_.size(); ++e) {
+        GeometryElement& element = elements_[e];
+        element.bounds = Box{};
+        const size_t points = element.r.size();
+        const bool rectangles = !element.dr.empty();
+        if (rectangles || points == 1) {
+            for (size_t i = 0; i < points; ++i) {
+                const double half_dr = rectangles ? std::abs(element.dr[i]) / 2 : 0.0;
+                const double half_dz = rectangles ? std::abs(element.dz[i]) / 2 : 0.0;
+                boxes.push_back({element.r[i] - half_dr, element.r[i] + half_dr, element.z[i] - half_dz,
+                                 element.z[i] + half_dz});
+                parts_.push_back({static_cast<uint32_t>(e), static_cast<uint32_t>(i), false});
+                element.bounds.expand(boxes.back());
+            }
+        } else {
+            for (size_t i = 0; i + 1 < points; ++i) {
+                boxes.push_back({std::min(element.r[i], element.r[i + 1]), std::max(element.r[i], element.r[i + 1]),
+                                 std::min(element.z[i], element.z[i + 1]), std::max(element.z[i], element.z[i + 1])});
+                parts_.push_back({static_cast<uint32_t>(e), static_cast<uint32_t>(i), true});
+                element.bounds.expand(boxes.back());
+            }
+        }
+    }
+
+    tree_ = PackedRTree{boxes};
+
+    std::vector<KdTree::Point> sensors;
+    for (size_t e = 0; e < elements_.size(); ++e) {
+        if (is_sensor(e)) {
+            sensors.push_back({elements_[e].r[0], elements_[e].z[0], static_cast<uint32_t>(e)});
+        }
+    }
+    sensors_ = KdTree{std::move(sensors)};
+}
+
+bool GeometryElementSet::intersects(const Part& part, const Box& box) const {
+    if (!part.segment) {
+        // The R-tree already tested the rectangle or point itself
+        return true;
+    }
+    const GeometryElement& element = elements_[part.element];
+    const size_t i = part.index;
+    return segment_intersects(element.r[i], element.z[i], element.r[i + 1], element.z[i + 1], box);
+}
+
+std::vector<size_t> GeometryElementSet::query(const Box& box) const {
+    std::vector<size_t> found;
+    tree_.query(box, [&](size_t part) {
+        if (intersects(parts_[part], box)) {
+            found.push_back(parts_[part].element);
+        }
+    });
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+} // namespace geometry_map_reader
@@ -0,0 +1,420 @@
+#ifndef GEOMETRY_MAP_READER_SPATIAL_H
+#define GEOMETRY_MAP_READER_SPATIAL_H
+
+#include "geometry_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace geometry_map_reader {
+
+/**
+ * A closed (R,Z) box. The default box is empty and expands to the first box added.
+ */
+struct Box {
+    double rmin = 1e300;
+    double rmax = -1e300;
+    double zmin = 1e300;
+    double zmax = -1e300;
+
+    [[nodiscard]] bool intersects(const Box& other) const {
+        return rmin <= other.rmax && other.rmin <= rmax && zmin <= other.zmax && other.zmin <= zmax;
+    }
+
+    void expand(const Box& other) {
+        rmin = other.rmin < rmin ? other.rmin : rmin;
+        rmax = other.rmax > rmax ? other.rmax : rmax;
+        zmin = other.zmin < zmin ? other.zmin : zmin;
+        zmax = other.zmax > zmax ? other.zmax : zmax;
+    }
+};
+
+/**
+ * Static R-tree over boxes, bulk loaded once with the sort-tile-recursive packing: the boxes are sorted into
+ * vertical slices by R and within each slice by Z, and consecutive runs of node_size boxes form the leaves.
+ * All levels are stored flat, leaves first, so a query walks arrays rather than pointers.
+ */
+class PackedRTree {
+  public:
+    static constexpr size_t default_node_size = 16;
+
+    // A node to visit in a nearest query, by its squared distance from the query point
+    struct Candidate {
+        double distance;
+        uint32_t position;
+        uint32_t level;
+    };
+
+    PackedRTree() = default;
+    explicit PackedRTree(const std::vector<Box>& boxes, size_t node_size = default_node_size);
+
+    /**
+     * Call f(item) for the index of every box intersecting box, in no particular order
+     */
+    template <typename F> void query(const Box& box, F&& f) const {
+        if (boxes_.empty()) {
+            return;
+        }
+        // Stack of (position, level) of the nodes still to visit
+        std::vector<std::pair<size_t, size_t>> stack;
+        stack.emplace_back(boxes_.size() - 1, level_ends_.size() - 1);
+        while (!stack.empty()) {
+            auto [position, level] = stack.back();
+            stack.pop_back();
+            if (!boxes_[position].intersects(box)) {
+                continue;
+            }
+            if (level == 0) {
+                f(static_cast<size_t>(indices_[position]));
+                continue;
+            }
+            const size_t first = indices_[position];
+            const size_t last = std::min(first + node_size_, level_ends_[level - 1]);
+            for (size_t child = first; child < last; ++child) {
+                stack.emplace_back(child, level - 1);
+            }
+        }
+    }
+
+    /**
+     * Find the item nearest (r, z), visiting the nodes in order of distance until the nearest is closer than all
+     * the nodes left. The items of a node are tested as it is visited rather than queued.
+     * @param distance called as distance(item) for the squared distance from (r, z) to an item, which must be no
+     * less than that to its box
+     * @param heap scratch space, reused across queries
+     * @return the (squared distance, item) of the nearest item, or (infinity, size()) if there are none
+     */
+    template <typename Distance>
+    std::pair<double, size_t> nearest(double r, double z, Distance&& distance, std::vector<Candidate>& heap) const {
+        std::pair<double, size_t> best{std::numeric_limits<double>::infinity(), size()};
+        if (boxes_.empty()) {
+            return best;
+        }
+        auto test = [&](size_t position) {
+            if (box_distance(boxes_[position], r, z) < best.first) {
+                const size_t item = indices_[position];
+                const double item_distance = distance(item);
+                best = item_distance < best.first ? std::pair<double, size_t>{item_distance, item} : best;
+            }
+        };
+        if (level_ends_.size() == 1) {
+            test(0);
+            return best;
+        }
+
+        auto farther = [](const Candidate& a, const Candidate& b) { return a.distance > b.distance; };
+        heap.clear();
+        heap.push_back({box_distance(boxes_.back(), r, z), static_cast<uint32_t>(boxes_.size() - 1),
+                        static_cast<uint32_t>(level_ends_.size() - 1)});
+        while (!heap.empty() && heap.front().distance < best.first) {
+            std::pop_heap(heap.begin(), heap.end(), farther);
+            const Candidate candidate = heap.back();
+            heap.pop_back();
+            const size_t first = indices_[candidate.position];
+            const size_t last = std::min(first + node_size_, level_ends_[candidate.level - 1]);
+            for (size_t child = first; child < last; ++child) {
+                if (candidate.level == 1) {
+                    test(child);
+                    continue;
+                }
+                const double child_distance = box_distance(boxes_[child], r, z);
+                if (child_distance < best.first) {
+                    heap.push_back({child_distance, static_cast<uint32_t>(child), candidate.level - 1});
+                    std::push_heap(heap.begin(), heap.end(), farther);
+                }
+            }
+        }
+        return best;
+    }
+
+    [[nodiscard]] size_t size() const { return level_ends_.empty() ? 0 : level_ends_[0]; }
+
+  private:
+    /**
+     * @return the squared distance from (r, z) to box, 0 inside it
+     */
+    static double box_distance(const Box& box, double r, double z) {
+        const double offset_r = r < box.rmin ? box.rmin - r : r > box.rmax ? r - box.rmax : 0.0;
+        const double offset_z = z < box.zmin ? box.zmin - z : z > box.zmax ? z - box.zmax : 0.0;
+        return offset_r * offset_r + offset_z * offset_z;
+    }
+
+    size_t node_size_ = default_node_size;
+    // The boxes of every level, leaves first and the root last
+    std::vector<Box> boxes_;
+    // For leaves the index of the item, for nodes the position of their first child
+    std::vector<uint32_t> indices_;
+    // The end position of each level in boxes_
+    std::vector<size_t> level_ends_;
+};
+
+/**
+ * Static 2-D tree over (R,Z) points for nearest neighbour queries. The points are stored in one array in the
+ * implicit layout of a balanced tree: the middle point of each range splits it, along the axis of the larger
+ * spread of the range, into the ranges either side of it.
+ */
+class KdTree {
+  public:
+    struct Point {
+        double r;
+        double z;
+        uint32_t id;
+    };
+
+    KdTree() = default;
+    explicit KdTree(std::vector<Point> points);
+
+    /**
+     * Find the k points nearest (r, z) among those with accept(id) true, points at equal distances ordered by id
+     * @param found set to the (squared distance, id) of the points found, nearest first
+     */
+    template <typename Accept>
+    void nearest(double r, double z, size_t k, Accept&& accept, std::vector<std::pair<double, uint32_t>>& found) const {
+        found.clear();
+        if (k > 0) {
+            search(0, points_.size(), r, z, k, accept, found, 0.0, 0.0, 0.0);
+        }
+        std::sort_heap(found.begin(), found.end());
+    }
+
+    [[nodiscard]] size_t size() const { return points_.size(); }
+
+  private:
+    void build(size_t begin, size_t end);
+
+    /**
+     * Search the range [begin, end) keeping found as a max-heap of the k nearest points so far. The range's cell
+     * is at squared distance cell_distance from the query point, offset by (offset_r, offset_z) along each axis.
+     */
+    template <typename Accept>
+    void search(size_t begin, size_t end, double r, double z, size_t k, Accept& accept,
+                std::vector<std::pair<double, uint32_t>>& found, double cell_distance, double offset_r,
+                double offset_z) const {
+        while (begin < end) {
+            const size_t middle = begin + (end - begin) / 2;
+            const Point& point = points_[middle];
+            if (accept(point.id)) {
+                const double distance = (point.r - r) * (point.r - r) + (point.z - z) * (point.z - z);
+                if (found.size() < k) {
+                    found.emplace_back(distance, point.id);
+                    std::push_heap(found.begin(), found.end());
+                } else if (std::make_pair(distance, point.id) < found.front()) {
+                    std::pop_heap(found.begin(), found.end());
+                    found.back() = {distance, point.id};
+                    std::push_heap(found.begin(), found.end());
+                }
+            }
+
+            // Search the side of the split holding the query point first, then the other side unless its cell is
+            // farther than the farthest point found, as a point of lower id at that distance would displace it
+            const bool split_r = split_r_[middle];
+            const double offset = split_r ? r - point.r : z - point.z;
+            const bool lower_first = offset < 0;
+            search(lower_first ? begin : middle + 1, lower_first ? middle : end, r, z, k, accept, found,
+                   cell_distance, offset_r, offset_z);
+            double& axis_offset = split_r ? offset_r : offset_z;
+            cell_distance += offset * offset - axis_offset * axis_offset;
+            axis_offset = offset;
+            if (found.size() == k && cell_distance > found.front().first) {
+                return;
+            }
+            begin = lower_first ? middle + 1 : begin;
+            end = lower_first ? end : middle;
+        }
+    }
+
+    std::vector<Point> points_;
+    // Whether the point at each position splits its range along R, else along Z
+    std::vector<bool> split_r_;
+};
+
+/**
+ * Closed (R,Z) contours, eg. limiter and first wall polygons, prepared for inside and distance tests of batches
+ * of points. For inside tests the edges are bucketed into Z bands of equal height, each band holding copies of
+ * the edges that cross it in flat arrays, so testing a point is a branch-free loop over the few edges of its band.
+ * Distances are found through an R-tree over the edges.
+ */
+class ContourSet {
+  public:
+    static constexpr size_t max_bands = 65536;
+
+    /**
+     * Add a contour of the points (r[i], z[i]), closed back to its first point. Call build once all are added.
+     */
+    void add(const std::vector<double>& r, const std::vector<double>& z);
+
+    /**
+     * Bucket the edges of the contours added into Z bands and build the R-tree over them
+     */
+    void build();
+
+    /**
+     * Set mask[i] to 1 if (r[i], z[i]) is inside the contours, else 0, by the crossing number of all their edges:
+     * a point inside two nested contours is outside, so an inner and an outer wall bound the region between them.
+     */
+    void inside(const double* r, const double* z, size_t count, unsigned char* mask) const;
+
+    /**
+     * Set distance[i] to the distance from (r[i], z[i]) to the nearest edge, negative where mask[i], the inside
+     * mask of the points as set by inside(), is set
+     */
+    void signed_distance(const double* r, const double* z, size_t count, const unsigned char* mask,
+                         double* distance) const;
+
+    [[nodiscard]] size_t contours() const { return contours_; }
+    [[nodiscard]] size_t edges() const { return edges_.size(); }
+    [[nodiscard]] const Box& bounds() const { return bounds_; }
+
+  private:
+    struct Edge {
+        double r0;
+        double z0;
+        double r1;
+        double z1;
+    };
+
+    /**
+     * @return the band holding z, which must be within the bounds
+     */
+    [[nodiscard]] size_t band(double z) const {
+        const auto index = static_cast<size_t>((z - bounds_.zmin) * band_scale_);
+        return std::min(index, band_ends_.size() - 1);
+    }
+
+    /**
+     * @return the number of edges of the band crossed by a ray from (r, z) towards increasing R
+     */
+    [[nodiscard]] unsigned int crossings(size_t band, double r, double z) const;
+
+    size_t contours_ = 0;
+    std::vector<Edge> edges_;
+    Box bounds_;
+    // Bands per unit Z
+    double band_scale_ = 0.0;
+    // The end position of each band in the arrays below
+    std::vector<size_t> band_ends_;
+    // The edges of each band: start point, end Z and dr / dz (0 if horizontal)
+    std::vector<double> r0_;
+    std::vector<double> z0_;
+    std::vector<double> z1_;
+    std::vector<double> slope_;
+    PackedRTree edge_tree_;
+};
+
+/**
+ * A grid of nr x nz (R,Z) points evenly spaced from (rmin, zmin) to (rmax, zmax) inclusive, nr and nz at least 2
+ */
+struct RasterGrid {
+    double rmin;
+    double rmax;
+    double zmin;
+    double zmax;
+    size_t nr;
+    size_t nz;
+
+    [[nodiscard]] double r(size_t i) const { return rmin + (rmax - rmin) * static_cast<double>(i) / (nr - 1); }
+    [[nodiscard]] double z(size_t j) const { return zmin + (zmax - zmin) * static_cast<double>(j) / (nz - 1); }
+};
+
+/**
+ * Rasterise the inside mask and signed distance of contours on grid, row by row of constant Z with the rows shared
+ * between up to threads threads. Both outputs hold nz rows of nr points.
+ */
+void rasterise(const ContourSet& contours, const RasterGrid& grid, size_t threads, unsigned char* mask,
+               double* distance);
+
+/**
+ * A geometry element: a node of a geometry tree with numeric r and z leaves of equal length, eg. a probe
+ * position, a coil with its filament centres or a wall contour. Elements with dr and dz leaves of the same
+ * length are sets of rectangles (eg. coil filaments), single points are points and longer r and z leaves are
+ * polylines.
+ */
+struct GeometryElement {
+    // Signal of the tree holding the element
+    std::string signal;
+    // Key of the element node in its tree (the r leaf is at path.r), empty for the root
+    std::string path;
+    std::vector<double> r;
+    std::vector<double> z;
+    std::vector<double> dr;
+    std::vector<double> dz;
+    Box bounds;
+};
+
+/**
+ * The geometry elements of a set of trees, eg. all the magnetics and wall geometry of a source, with an R-tree
+ * over their parts (rectangles, points and polyline segments) for region queries.
+ */
+class GeometryElementSet {
+  public:
+    /**
+     * Add the elements of a fetched tree. Call build once all trees are added.
+     */
+    void add_tree(std::string_view signal, const GeometryIndex& index);
+
+    /**
+     * Build the R-tree over the parts of the elements added
+     */
+    void build();
+
+    /**
+     * @return the indices of the elements with a part intersecting box, in the order they were added
+     */
+    [[nodiscard]] std::vector<size_t> query(const Box& box) const;
+
+    /**
+     * Find the k sensors nearest (r, z) among those with accept(element) true, where sensors are the elements
+     * of a single point without dr and dz (eg. probes and flux loops), sensors at equal distances in the order
+     * they were added
+     * @param found set to the (distance, element index) of the sensors found, nearest first
+     */
+    template <typename Accept>
+    void nearest(double r, double z, size_t k, Accept&& accept, std::vector<std::pair<double, uint32_t>>& found) const {
+        sensors_.nearest(r, z, k, accept, found);
+        for (auto& entry : found) {
+            entry.first = std::sqrt(entry.first);
+        }
+    }
+
+    /**
+     * @return true if the element is a sensor (see nearest)
+     */
+    [[nodiscard]] bool is_sensor(size_t element) const {
+        return elements_[element].r.size() == 1 && elements_[element].dr.empty();
+    }
+
+    /**
+     * @return true if the element is a contour, a polyline of at least 3 points (eg. a limiter or wall)
+     */
+    [[nodiscard]] bool is_contour(size_t element) const {
+        return elements_[element].r.size() >= 3 && elements_[element].dr.empty();
+    }
+
+    [[nodiscard]] const std::vector<GeometryElement>& elements() const { return elements_; }
+
+  private:
+    // A rectangle, point or polyline segment of an element: segment i joins points i and i + 1
+    struct Part {
+        uint32_t element;
+        uint32_t index;
+        bool segment;
+    };
+
+    [[nodiscard]] bool intersects(const Part& part, const Box& box) const;
+
+    std::vector<GeometryElement> elements_;
+    std::vector<Part> parts_;
+    PackedRTree tree_;
+    KdTree sensors_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_SPATIAL_H
@@ -0,0 +1,124 @@
+#include "geometry_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace geometry_map_reader {
+
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    // Values below sub_buckets are exact; above that the top sub_bucket_bits + 1 bits select the bucket
+    if (value < static_cast<uint64_t>(sub_buckets)) {
+        return static_cast<size_t>(value);
+    }
+    int magnitude = 63 - __builtin_clzll(value) - sub_bucket_bits + 1;
+    auto sub_bucket = static_cast<size_t>((value >> (magnitude - 1)) & (sub_buckets - 1));
+    return static_cast<size_t>(magnitude) * sub_buckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    auto magnitude = static_cast<int>(index / sub_buckets);
+    auto sub_bucket = static_cast<uint64_t>(index % sub_buckets);
+    if (magnitude == 0) {
+        return sub_bucket;
+    }
+    return ((sub_buckets + sub_bucket + 1) << (magnitude - 1)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    ++buckets_[bucket_index(nanoseconds)];
+    ++count_;
+    total_ += nanoseconds;
+    max_ = std::max(max_, nanoseconds);
+}
+
+void LatencyHistogram::reset() {
+    buckets_.fill(0);
+    count_ = 0;
+    total_ = 0;
+    max_ = 0;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    total_ += other.total_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    auto target = static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * count_));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return std::min(bucket_upper_bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::Parse:
+            return "parse";
+        case Phase::CacheProbe:
+            return "cache_probe";
+        case Phase::StoreLoad:
+            return "store_load";
+        case Phase::Fetch:
+            return "fetch";
+        case Phase::TreeCheck:
+            return "tree_check";
+        case Phase::IndexBuild:
+            return "index_build";
+        case Phase::StoreSave:
+            return "store_save";
+        case Phase::CacheInsert:
+            return "cache_insert";
+        case Phase::Lookup:
+            return "lookup";
+        case Phase::Marshal:
+            return "marshal";
+        case Phase::Total:
+            return "total";
+        default:
+            return "unknown";
+    }
+}
+
+const char* outcome_name(Outcome outcome) {
+    switch (outcome) {
+        case Outcome::CacheHit:
+            return "cache_hit";
+        case Outcome::StoreHit:
+            return "store_hit";
+        case Outcome::Fetched:
+            return "fetched";
+        case Outcome::FetchError:
+            return "fetch_error";
+        case Outcome::NegativeHit:
+            return "negative_hit";
+        case Outcome::KeyNotFound:
+            return "key_not_found";
+        case Outcome::Returned:
+            return "returned";
+        default:
+            return "unknown";
+    }
+}
+
+void PluginStats::reset() {
+    for (auto& histogram : histograms_) {
+        histogram.reset();
+    }
+    counters_.fill(0);
+}
+
+} // namespace geometry_map_reader
@@ -0,0 +1,162 @@
+#ifndef GEOMETRY_MAP_READER_STATS_H
+#define GEOMETRY_MAP_READER_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "geometry_trace.h"
+
+namespace geometry_map_reader {
+
+/**
+ * Log-linear latency histogram in the style of HdrHistogram: each power of two range of nanoseconds is split
+ * into 16 linear sub-buckets, bounding the relative error of any reported percentile to 1/16. Recording is a
+ * couple of bit operations and an increment.
+ */
+class LatencyHistogram {
+  public:
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    /**
+     * Add the recorded values of another histogram to this one
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @param quantile in [0, 1], eg. 0.99
+     * @return the upper bound in nanoseconds of the bucket holding the quantile, 0 if nothing was recorded
+     */
+    [[nodiscard]] uint64_t percentile(double quantile) const;
+
+    [[nodiscard]] uint64_t count() const { return count_; }
+    [[nodiscard]] uint64_t max() const { return max_; }
+    [[nodiscard]] double mean() const { return count_ ? static_cast<double>(total_) / count_ : 0.0; }
+
+  private:
+    static constexpr int sub_bucket_bits = 4;
+    static constexpr int sub_buckets = 1 << sub_bucket_bits;
+    static constexpr int magnitudes = 64 - sub_bucket_bits + 1;
+
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(size_t index);
+
+    std::array<uint64_t, magnitudes * sub_buckets> buckets_ = {};
+    uint64_t count_ = 0;
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+};
+
+/**
+ * Phases of a GEOMETRY request that are timed
+ */
+enum class Phase : size_t {
+    Parse,       // argument parsing and request key set up
+    CacheProbe,  // negative cache and tree cache probes
+    StoreLoad,   // reading a tree from the on-disk store
+    Fetch,       // the GEOM::get round trip
+    TreeCheck,   // result checks and skipping the wrapper levels of the tree
+    IndexBuild,  // building the leaf index of a fetched tree
+    StoreSave,   // writing a fetched tree to the on-disk store
+    CacheInsert, // inserting a fetched or stored tree into the tree cache
+    Lookup,      // resolution of the key in the tree's index
+    Marshal,     // copying leaves into the returned data
+    Total,       // the whole request
+    Count
+};
+
+/**
+ * Outcomes of GEOMETRY::get requests that are counted
+ */
+enum class Outcome : size_t {
+    CacheHit,
+    StoreHit,
+    Fetched,
+    FetchError,
+    NegativeHit,
+    KeyNotFound,
+    Returned,
+    Count
+};
+
+const char* phase_name(Phase phase);
+const char* outcome_name(Outcome outcome);
+
+/**
+ * Latency histograms per phase and counters per outcome, owned by the plugin instance. If a trace buffer is set
+ * every recorded phase is also written to it as a trace event.
+ */
+class PluginStats {
+  public:
+    using clock = TraceBuffer::clock;
+
+    void record(Phase phase, clock::time_point begin, clock::time_point end) {
+        histograms_[static_cast<size_t>(phase)].record(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+        if (trace_ != nullptr) {
+            trace_->record(phase_name(phase), "phase", begin, end);
+        }
+    }
+    void count(Outcome outcome) { ++counters_[static_cast<size_t>(outcome)]; }
+    void reset();
+
+    [[nodiscard]] const LatencyHistogram& histogram(Phase phase) const {
+        return histograms_[static_cast<size_t>(phase)];
+    }
+    [[nodiscard]] uint64_t counter(Outcome outcome) const { return counters_[static_cast<size_t>(outcome)]; }
+
+    void set_trace(TraceBuffer* trace) { trace_ = trace; }
+    [[nodiscard]] TraceBuffer* trace() const { return trace_; }
+
+  private:
+    TraceBuffer* trace_ = nullptr;
+    std::array<LatencyHistogram, static_cast<size_t>(Phase::Count)> histograms_ = {};
+    std::array<uint64_t, static_cast<size_t>(Outcome::Count)> counters_ = {};
+};
+
+/**
+ * Records the time between successive laps as the named phase
+ */
+class PhaseTimer {
+  public:
+    explicit PhaseTimer(PluginStats& stats) : stats_{stats}, last_{PluginStats::clock::now()} {}
+
+    void lap(Phase phase) {
+        auto now = PluginStats::clock::now();
+        stats_.record(phase, last_, now);
+        last_ = now;
+    }
+
+    /**
+     * Start the next lap now, without recording the time since the last one
+     */
+    void restart() { last_ = PluginStats::clock::now(); }
+
+  private:
+    PluginStats& stats_;
+    PluginStats::clock::time_point last_;
+};
+
+/**
+ * Records the lifetime of the timer as the named phase
+ */
+class ScopedPhaseTimer {
+  public:
+    ScopedPhaseTimer(PluginStats& stats, Phase phase)
+        : stats_{stats}, phase_{phase}, start_{PluginStats::clock::now()} {}
+    ~ScopedPhaseTimer() { stats_.record(phase_, start_, PluginStats::clock::now()); }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+  private:
+    PluginStats& stats_;
+    Phase phase_;
+    PluginStats::clock::time_point start_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_STATS_H
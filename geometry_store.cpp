@@ -0,0 +1,392 @@
+#include "geometry_store.h"
+
+#include <plugins/udaPlugin.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace geometry_map_reader {
+
+namespace {
+
+constexpr char store_magic[8] = {'G', 'E', 'O', 'M', 'T', 'R', 'E', 'E'};
+constexpr uint32_t store_version = 1;
+constexpr const char* temp_suffix = ".tmp";
+
+// Unreferenced objects and temporary files younger than this are kept by collect, as the save writing them may
+// not have written its reference or renamed them yet
+constexpr std::chrono::minutes collect_grace{10};
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t leaf_count;
+    uint64_t file_size;
+};
+
+struct StoreRecord {
+    uint64_t key_offset;
+    uint64_t shape_offset;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint32_t key_length;
+    int32_t type;
+    uint32_t rank;
+    uint32_t shape_length;
+};
+
+uint64_t fnv1a(std::string_view bytes) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char byte : bytes) {
+        hash ^= static_cast<unsigned char>(byte);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t{7};
+}
+
+size_t leaf_bytes(const GeometryLeaf& leaf) {
+    if (leaf.type == UDA_TYPE_STRING) {
+        return leaf.data != nullptr ? std::strlen(static_cast<const char*>(leaf.data)) + 1 : 0;
+    }
+    return leaf.count() * uda_type_size(leaf.type);
+}
+
+std::string serialise(const GeometryIndex& index) {
+    // Lay out the sections: header | records | shapes | keys | data
+    uint64_t shapes_offset = sizeof(StoreHeader) + index.size() * sizeof(StoreRecord);
+    uint64_t keys_offset = shapes_offset;
+    index.for_each_leaf([&](std::string_view, const GeometryLeaf& leaf) {
+        keys_offset += leaf.shape.size() * sizeof(uint64_t);
+    });
+    uint64_t data_offset = keys_offset;
+    index.for_each_leaf([&](std::string_view key, const GeometryLeaf&) { data_offset += key.size(); });
+    data_offset = align8(data_offset);
+
+    std::vector<StoreRecord> records;
+    std::vector<uint64_t> shapes;
+    std::string keys;
+    uint64_t file_size = data_offset;
+
+    index.for_each_leaf([&](std::string_view key, const GeometryLeaf& leaf) {
+        StoreRecord record{};
+        record.key_offset = keys_offset + keys.size();
+        record.key_length = static_cast<uint32_t>(key.size());
+        record.shape_offset = shapes_offset + shapes.size() * sizeof(uint64_t);
+        record.shape_length = static_cast<uint32_t>(leaf.shape.size());
+        record.type = leaf.type;
+        record.rank = static_cast<uint32_t>(leaf.rank);
+        record.data_offset = file_size;
+        record.data_bytes = leaf_bytes(leaf);
+        records.push_back(record);
+
+        keys.append(key);
+        shapes.insert(shapes.end(), leaf.shape.begin(), leaf.shape.end());
+        file_size = align8(file_size + record.data_bytes);
+    });
+
+    std::string buffer(file_size, '\0');
+    StoreHeader header{};
+    std::memcpy(header.magic, store_magic, sizeof(store_magic));
+    header.version = store_version;
+    header.leaf_count = static_cast<uint32_t>(records.size());
+    header.file_size = file_size;
+
+    // An empty vector's data() may be null, which memcpy must not be given even for zero bytes
+    std::memcpy(&buffer[0], &header, sizeof(header));
+    if (!records.empty()) {
+        std::memcpy(&buffer[sizeof(header)], records.data(), records.size() * sizeof(StoreRecord));
+    }
+    if (!shapes.empty()) {
+        std::memcpy(&buffer[shapes_offset], shapes.data(), shapes.size() * sizeof(uint64_t));
+    }
+    if (!keys.empty()) {
+        std::memcpy(&buffer[keys_offset], keys.data(), keys.size());
+    }
+
+    size_t leaf_number = 0;
+    index.for_each_leaf([&](std::string_view, const GeometryLeaf& leaf) {
+        const StoreRecord& record = records[leaf_number++];
+        if (record.data_bytes > 0) {
+            std::memcpy(&buffer[record.data_offset], leaf.data, record.data_bytes);
+        }
+    });
+
+    return buffer;
+}
+
+bool in_bounds(uint64_t offset, uint64_t length, size_t size) {
+    return length <= size && offset <= size - length;
+}
+
+bool stored_type(int32_t type) {
+    switch (type) {
+        case UDA_TYPE_CHAR:
+        case UDA_TYPE_UNSIGNED_CHAR:
+        case UDA_TYPE_SHORT:
+        case UDA_TYPE_UNSIGNED_SHORT:
+        case UDA_TYPE_INT:
+        case UDA_TYPE_UNSIGNED_INT:
+        case UDA_TYPE_LONG:
+        case UDA_TYPE_UNSIGNED_LONG:
+        case UDA_TYPE_LONG64:
+        case UDA_TYPE_UNSIGNED_LONG64:
+        case UDA_TYPE_FLOAT:
+        case UDA_TYPE_DOUBLE:
+        case UDA_TYPE_STRING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Check a record against the object it was read from before its leaf is used in place: its sections must lie
+ * within the object, aligned for their element type, its type must be an atomic type and its shape must match its
+ * rank (a scalar may have a shape of one element). Its data must hold exactly the elements of its shape, or a
+ * null terminated string.
+ */
+bool valid_record(const StoreRecord& record, const char* base, size_t size) {
+    if (!in_bounds(record.key_offset, record.key_length, size) ||
+        !in_bounds(record.shape_offset, uint64_t{record.shape_length} * sizeof(uint64_t), size) ||
+        !in_bounds(record.data_offset, record.data_bytes, size) || record.shape_offset % alignof(uint64_t) != 0 ||
+        record.data_offset % 8 != 0 || !stored_type(record.type)) {
+        return false;
+    }
+
+    const char* shape_data = base + record.shape_offset;
+    uint64_t count = 1;
+    for (uint32_t i = 0; i < record.shape_length; ++i) {
+        uint64_t dim;
+        std::memcpy(&dim, shape_data + i * sizeof(uint64_t), sizeof(dim));
+        if (dim != 0 && count > UINT64_MAX / dim) {
+            return false;
+        }
+        count *= dim;
+    }
+    if (record.rank != record.shape_length && !(record.rank == 0 && record.shape_length == 1 && count == 1)) {
+        return false;
+    }
+
+    if (record.type == UDA_TYPE_STRING) {
+        return record.data_bytes == 0 || base[record.data_offset + record.data_bytes - 1] == '\0';
+    }
+    uint64_t type_size = uda_type_size(static_cast<UDA_TYPE>(record.type));
+    return count <= UINT64_MAX / type_size && record.data_bytes == count * type_size;
+}
+
+bool write_file(const std::filesystem::path& path, std::string_view contents) {
+    // Write a uniquely named temporary file then rename it, so that readers never see a partial file and
+    // concurrent writers of the same file do not write into each other's
+    std::string temp = path.string() + ".XXXXXX" + temp_suffix;
+    int fd = mkstemps(temp.data(), static_cast<int>(std::strlen(temp_suffix)));
+    if (fd < 0) {
+        return false;
+    }
+    // mkstemps creates the file readable by its owner only, but the store may be shared
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t result = write(fd, contents.data() + written, contents.size() - written);
+        if (result < 0) {
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+    bool ok = close(fd) == 0 && written == contents.size() && rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        unlink(temp.c_str());
+    }
+    return ok;
+}
+
+std::shared_ptr<const void> map_file(const std::string& path, size_t& size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info = {};
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        size = static_cast<size_t>(info.st_size);
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    return {mapping, [size](const void* ptr) { munmap(const_cast<void*>(ptr), size); }};
+}
+
+/**
+ * @return true if the file at path holds exactly contents
+ */
+bool same_contents(const std::filesystem::path& path, std::string_view contents) {
+    size_t size = 0;
+    std::shared_ptr<const void> mapping = map_file(path.string(), size);
+    return mapping && size == contents.size() && std::memcmp(mapping.get(), contents.data(), size) == 0;
+}
+
+bool older_than(const std::filesystem::path& path, std::chrono::seconds age) {
+    std::error_code error;
+    auto written = std::filesystem::last_write_time(path, error);
+    return !error && std::filesystem::file_time_type::clock::now() - written > age;
+}
+
+} // namespace
+
+GeometryStore::GeometryStore(std::string directory, std::chrono::seconds ttl)
+    : directory_{std::move(directory)}, ttl_{ttl} {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path{directory_} / "objects", error);
+    std::filesystem::create_directories(std::filesystem::path{directory_} / "refs", error);
+    if (error) {
+        UDA_LOG(UDA_LOG_WARN, "\nimas_json_plugin::plugin_helpers::GeometryStore: Unable to create store directory\n");
+    }
+}
+
+std::string GeometryStore::ref_name(const GeometryCacheKey& key) {
+    return fmt::format("{}|{}|{}|{}|{}|{}", static_cast<int>(key.backend), key.host, key.port, key.source, key.config,
+                       key.signal);
+}
+
+std::string GeometryStore::ref_path(const std::string& name) const {
+    return fmt::format("{}/refs/{:016x}", directory_, fnv1a(name));
+}
+
+bool GeometryStore::save(const GeometryCacheKey& key, const GeometryIndex& index) const {
+    std::string object = serialise(index);
+    std::string hash = fmt::format("{:016x}", fnv1a(object));
+
+    // An existing object is only reused if it holds the same tree: one left truncated, eg. by a full disk, or
+    // holding a different tree of the same hash is replaced
+    std::filesystem::path object_path = std::filesystem::path{directory_} / "objects" / (hash + ".geom");
+    if (same_contents(object_path, object)) {
+        // Keep the object from being collected before its new reference is written
+        std::error_code error;
+        std::filesystem::last_write_time(object_path, std::filesystem::file_time_type::clock::now(), error);
+    } else if (!write_file(object_path, object)) {
+        UDA_LOG(UDA_LOG_WARN, "\nimas_json_plugin::plugin_helpers::GeometryStore: Unable to write object\n");
+        return false;
+    }
+
+    // The full reference name is recorded alongside the object hash to detect ref file name collisions
+    std::string name = ref_name(key);
+    return write_file(ref_path(name), fmt::format("{}\n{}\n", hash, name));
+}
+
+bool GeometryStore::remove(const GeometryCacheKey& key) const {
+    std::error_code error;
+    return std::filesystem::remove(ref_path(ref_name(key)), error);
+}
+
+size_t GeometryStore::collect() const {
+    namespace fs = std::filesystem;
+    size_t removed = 0;
+    std::error_code error;
+
+    // Expired references are dropped, and the objects the others name are kept
+    std::unordered_set<std::string> referenced;
+    for (const auto& entry : fs::directory_iterator{fs::path{directory_} / "refs", error}) {
+        const fs::path& path = entry.path();
+        bool temp = path.extension() == temp_suffix;
+        if (temp ? older_than(path, collect_grace) : ttl_.count() > 0 && older_than(path, ttl_)) {
+            std::error_code remove_error;
+            removed += fs::remove(path, remove_error);
+            continue;
+        }
+        std::ifstream ref{path};
+        std::string hash;
+        if (!temp && std::getline(ref, hash)) {
+            referenced.insert(hash + ".geom");
+        }
+    }
+    if (error) {
+        // Without every reference read, any object might still be referenced
+        UDA_LOG(UDA_LOG_WARN, "\nimas_json_plugin::plugin_helpers::collect: Unable to read store references\n");
+        return removed;
+    }
+
+    for (const auto& entry : fs::directory_iterator{fs::path{directory_} / "objects", error}) {
+        const fs::path& path = entry.path();
+        if (referenced.count(path.filename().string()) == 0 && older_than(path, collect_grace)) {
+            std::error_code remove_error;
+            removed += fs::remove(path, remove_error);
+        }
+    }
+    return removed;
+}
+
+std::optional<GeometryCacheEntry> GeometryStore::load(const GeometryCacheKey& key) const {
+    std::string name = ref_name(key);
+    std::string path = ref_path(name);
+    std::string hash;
+    std::string stored_name;
+    {
+        std::ifstream ref{path};
+        if (!std::getline(ref, hash) || !std::getline(ref, stored_name) || stored_name != name) {
+            return std::nullopt;
+        }
+    }
+    if (ttl_.count() > 0) {
+        std::error_code error;
+        auto written = std::filesystem::last_write_time(path, error);
+        if (error || std::filesystem::file_time_type::clock::now() - written > ttl_) {
+            return std::nullopt;
+        }
+    }
+
+    size_t size = 0;
+    std::shared_ptr<const void> mapping = map_file(fmt::format("{}/objects/{}.geom", directory_, hash), size);
+    if (!mapping || size < sizeof(StoreHeader)) {
+        return std::nullopt;
+    }
+
+    const char* base = static_cast<const char*>(mapping.get());
+    StoreHeader header{};
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, store_magic, sizeof(store_magic)) != 0 || header.version != store_version ||
+        header.file_size != size || sizeof(StoreHeader) + header.leaf_count * sizeof(StoreRecord) > size) {
+        UDA_LOG(UDA_LOG_WARN, "\nimas_json_plugin::plugin_helpers::GeometryStore: Invalid object\n");
+        return std::nullopt;
+    }
+
+    auto index = std::make_shared<GeometryIndex>();
+    auto records = reinterpret_cast<const StoreRecord*>(base + sizeof(StoreHeader));
+    for (uint32_t i = 0; i < header.leaf_count; ++i) {
+        const StoreRecord& record = records[i];
+        if (!valid_record(record, base, size)) {
+            UDA_LOG(UDA_LOG_WARN, "\nimas_json_plugin::plugin_helpers::GeometryStore: Invalid object record\n");
+            return std::nullopt;
+        }
+
+        auto shape = reinterpret_cast<const uint64_t*>(base + record.shape_offset);
+        GeometryLeaf leaf{static_cast<UDA_TYPE>(record.type), record.rank,
+                          std::vector<size_t>(shape, shape + record.shape_length),
+                          record.data_bytes > 0 ? base + record.data_offset : nullptr};
+        index->add_leaf(std::string{base + record.key_offset, record.key_length}, std::move(leaf));
+    }
+
+    return GeometryCacheEntry{index, mapping, size};
+}
+
+} // namespace geometry_map_reader
@@ -0,0 +1,67 @@
+#ifndef GEOMETRY_MAP_READER_STORE_H
+#define GEOMETRY_MAP_READER_STORE_H
+
+#include "geometry_cache.h"
+#include "geometry_index.h"
+
+#include <chrono>
+#include <optional>
+#include <string>
+
+namespace geometry_map_reader {
+
+/**
+ * Persistent on-disk store of geometry trees.
+ *
+ * Each tree is written as a single flat binary object (header, leaf records, shapes, keys then 8 byte aligned
+ * leaf data) named by the FNV-1a hash of its content, under <directory>/objects. A small reference file per
+ * request key (backend, endpoint, source, signal and config) under <directory>/refs names the object holding
+ * that tree, so identical trees are stored once. Objects are read back with mmap and indexed in place: leaf data
+ * points into the mapping and is never copied or decoded.
+ *
+ * References older than the time to live, if set, are ignored, and a reference is dropped by remove. Objects,
+ * possibly shared by several references, are only deleted by collect once no reference names them.
+ */
+class GeometryStore {
+  public:
+    explicit GeometryStore(std::string directory, std::chrono::seconds ttl = std::chrono::seconds{0});
+
+    /**
+     * @return the stored tree, backed by a read-only mapping of its object, or nothing if not stored, expired or
+     * invalid
+     */
+    [[nodiscard]] std::optional<GeometryCacheEntry> load(const GeometryCacheKey& key) const;
+
+    /**
+     * Write the tree to the store, replacing any previous tree for the same key.
+     * @return true on success
+     */
+    bool save(const GeometryCacheKey& key, const GeometryIndex& index) const;
+
+    /**
+     * Drop the reference to the tree of the key, if stored
+     * @return true if a tree was stored
+     */
+    bool remove(const GeometryCacheKey& key) const;
+
+    /**
+     * Delete the references older than the time to live, if set, then the objects no reference names and any
+     * temporary files left by interrupted saves. Objects and temporary files written in the last few minutes are
+     * kept, as a save may still be writing them.
+     * @return the number of files deleted
+     */
+    size_t collect() const;
+
+    [[nodiscard]] const std::string& directory() const { return directory_; }
+
+  private:
+    [[nodiscard]] static std::string ref_name(const GeometryCacheKey& key);
+    [[nodiscard]] std::string ref_path(const std::string& name) const;
+
+    std::string directory_;
+    std::chrono::seconds ttl_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_STORE_H
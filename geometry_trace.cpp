@@ -0,0 +1,40 @@
+#include "geometry_trace.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+#include <cstdio>
+#include <memory>
+#include <unistd.h>
+
+namespace geometry_map_reader {
+
+long TraceBuffer::write_chrome_trace(const std::string& path) const {
+    std::unique_ptr<FILE, int (*)(FILE*)> file{std::fopen(path.c_str(), "w"), &std::fclose};
+    if (!file) {
+        return -1;
+    }
+
+    uint64_t next = next_.load(std::memory_order_relaxed);
+    uint64_t count = std::min<uint64_t>(next, events_.size());
+    int pid = getpid();
+
+    fmt::print(file.get(), "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (uint64_t i = next - count; i < next; ++i) {
+        const TraceEvent& event = events_[i % events_.size()];
+        // Chrome trace timestamps are in microseconds
+        fmt::print(file.get(), "{}{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+                               "\"pid\":{},\"tid\":0}}",
+                   i == next - count ? "\n" : ",\n", event.name, event.category, event.begin_ns / 1000.0,
+                   event.duration_ns / 1000.0, pid);
+    }
+    fmt::print(file.get(), "\n]}}\n");
+
+    if (std::ferror(file.get())) {
+        return -1;
+    }
+    return static_cast<long>(count);
+}
+
+} // namespace geometry_map_reader
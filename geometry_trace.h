@@ -0,0 +1,87 @@
+#ifndef GEOMETRY_MAP_READER_TRACE_H
+#define GEOMETRY_MAP_READER_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace geometry_map_reader {
+
+/**
+ * A timed span, written as a Chrome trace complete ("X") event carrying both its begin time and duration
+ */
+struct TraceEvent {
+    const char* name = nullptr;
+    const char* category = nullptr;
+    int64_t begin_ns = 0;
+    int64_t duration_ns = 0;
+};
+
+/**
+ * Fixed size ring buffer of trace events. Writers claim a slot with a single atomic increment and never block;
+ * once the buffer is full the oldest events are overwritten. Event names and categories must be string
+ * literals as only the pointers are stored.
+ */
+class TraceBuffer {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TraceBuffer(size_t capacity) : events_(capacity) {}
+
+    void record(const char* name, const char* category, clock::time_point begin, clock::time_point end) {
+        uint64_t slot = next_.fetch_add(1, std::memory_order_relaxed);
+        TraceEvent& event = events_[slot % events_.size()];
+        event.name = name;
+        event.category = category;
+        event.begin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count();
+        event.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    }
+
+    /**
+     * Write the buffered events, oldest first, as a Chrome trace JSON file loadable by Perfetto.
+     * @return the number of events written or -1 if the file could not be written
+     */
+    long write_chrome_trace(const std::string& path) const;
+
+    void clear() { next_.store(0, std::memory_order_relaxed); }
+
+    [[nodiscard]] size_t capacity() const { return events_.size(); }
+
+  private:
+    std::vector<TraceEvent> events_;
+    std::atomic<uint64_t> next_{0};
+};
+
+/**
+ * Records its lifetime as a trace event if tracing is enabled (trace is not null)
+ */
+class TraceSpan {
+  public:
+    TraceSpan(TraceBuffer* trace, const char* name, const char* category)
+        : trace_{trace}, name_{name}, category_{category} {
+        if (trace_ != nullptr) {
+            begin_ = TraceBuffer::clock::now();
+        }
+    }
+    ~TraceSpan() {
+        if (trace_ != nullptr) {
+            trace_->record(name_, category_, begin_, TraceBuffer::clock::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+  private:
+    TraceBuffer* trace_;
+    const char* name_;
+    const char* category_;
+    TraceBuffer::clock::time_point begin_;
+};
+
+} // namespace geometry_map_reader
+
+#endif // GEOMETRY_MAP_READER_TRACE_H
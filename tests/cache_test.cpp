@@ -0,0 +1,128 @@
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "geometry_plugin.h"
+#include "geometry_source_memory.h"
+#include "plugin_request.h"
+
+using geometry_map_reader::test::PluginRequest;
+
+namespace {
+
+std::unique_ptr<geometry_map_reader::MemoryTreeNode> make_coil(int turns) {
+    auto tree = std::make_unique<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coil = tree->add_child("coil");
+    const double r[] = {1.0, 1.5, 2.0, 2.5};
+    coil.add_array<double>("r", r, {4});
+    coil.add_scalar<int>("turns", turns);
+    coil.add_string("name", "d1_upper");
+    return tree;
+}
+
+/**
+ * Hands out a fresh copy of a tree per fetch, as UdaGeometrySource copies the tree out of each result, and tracks
+ * which copies are still alive
+ */
+class CopyingSource final : public geometry_map_reader::GeometrySource {
+  public:
+    void add(const std::string& signal, std::unique_ptr<geometry_map_reader::MemoryTreeNode> tree) {
+        trees_[signal] = std::move(tree);
+    }
+
+    int fetch(const geometry_map_reader::GeometryCacheKey& key,
+              std::optional<geometry_map_reader::GeometryCacheEntry>& entry) override {
+        auto found = trees_.find(key.signal);
+        if (found == trees_.end()) {
+            return 1;
+        }
+        auto copy = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+        geometry_map_reader::copy_tree(geometry_map_reader::MemoryTreeRef{*found->second}, *copy);
+        auto index = std::make_shared<const geometry_map_reader::GeometryIndex>(
+            geometry_map_reader::GeometryIndex::build(geometry_map_reader::MemoryTreeRef{*copy}));
+        copies_[key.signal] = copy;
+        entry.emplace(geometry_map_reader::GeometryCacheEntry{index, std::move(copy), index->bytes()});
+        return 0;
+    }
+
+    [[nodiscard]] bool alive(const std::string& signal) const {
+        auto found = copies_.find(signal);
+        return found != copies_.end() && !found->second.expired();
+    }
+
+  private:
+    std::map<std::string, std::unique_ptr<geometry_map_reader::MemoryTreeNode>> trees_;
+    std::map<std::string, std::weak_ptr<geometry_map_reader::MemoryTreeNode>> copies_;
+};
+
+int get_turns(GeometryMapReaderPlugin& plugin, const char* signal) {
+    PluginRequest get{"get", {{"host", "localhost"}, {"port", "56565"}, {"source", "1"}, {"signal", signal},
+                              {"key", "coil.turns"}}};
+    GEOMETRY_CHECK(plugin.get(get.interface()) == 0);
+    return *reinterpret_cast<const int*>(get.data_block().data);
+}
+
+/**
+ * The copied leaves keep their type, shape, rank and data
+ */
+void test_copy_tree() {
+    auto tree = make_coil(5);
+    geometry_map_reader::MemoryTreeNode copy{"data"};
+    geometry_map_reader::copy_tree(geometry_map_reader::MemoryTreeRef{*tree}, copy);
+    tree.reset();
+
+    GEOMETRY_CHECK(copy.children.size() == 1 && copy.children[0].atomics.size() == 3);
+    const auto& [r_name, r] = copy.children[0].atomics[0];
+    GEOMETRY_CHECK(r_name == "r" && r.type == UDA_TYPE_DOUBLE && r.rank == 1 && r.count() == 4);
+    GEOMETRY_CHECK(static_cast<const double*>(r.data)[3] == 2.5);
+    const auto& turns = copy.children[0].atomics[1].second;
+    GEOMETRY_CHECK(turns.rank == 0 && *static_cast<const int*>(turns.data) == 5);
+    const auto& name = copy.children[0].atomics[2].second;
+    GEOMETRY_CHECK(std::string{static_cast<const char*>(name.data)} == "d1_upper");
+}
+
+/**
+ * A tree evicted from the cache to stay within GEOMETRY_CACHE_BYTES is freed, and fetched again when requested
+ */
+void test_eviction_frees_tree() {
+    CopyingSource source;
+    source.add("/magnetics/pfcoil/d1_upper", make_coil(5));
+    source.add("/magnetics/pfcoil/d1_lower", make_coil(7));
+
+    // Budget for one tree but not two
+    std::optional<geometry_map_reader::GeometryCacheEntry> probe;
+    GEOMETRY_CHECK(source.fetch({"localhost", 56565, 1, "/magnetics/pfcoil/d1_upper", 0}, probe) == 0);
+    setenv("GEOMETRY_CACHE_BYTES", std::to_string(probe->bytes * 3 / 2).c_str(), 1);
+    probe.reset();
+
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &source);
+
+    GEOMETRY_CHECK(get_turns(plugin, "/MAGNETICS/PFCOIL/D1_UPPER") == 5);
+    GEOMETRY_CHECK(source.alive("/magnetics/pfcoil/d1_upper"));
+
+    GEOMETRY_CHECK(get_turns(plugin, "/MAGNETICS/PFCOIL/D1_LOWER") == 7);
+    GEOMETRY_CHECK(source.alive("/magnetics/pfcoil/d1_lower"));
+    GEOMETRY_CHECK(!source.alive("/magnetics/pfcoil/d1_upper"));
+
+    GEOMETRY_CHECK(get_turns(plugin, "/MAGNETICS/PFCOIL/D1_UPPER") == 5);
+    GEOMETRY_CHECK(source.alive("/magnetics/pfcoil/d1_upper"));
+    GEOMETRY_CHECK(!source.alive("/magnetics/pfcoil/d1_lower"));
+
+    plugin.reset(init.interface());
+    GEOMETRY_CHECK(!source.alive("/magnetics/pfcoil/d1_upper"));
+    unsetenv("GEOMETRY_CACHE_BYTES");
+}
+
+} // namespace
+
+int main() {
+    test_copy_tree();
+    test_eviction_frees_tree();
+    return 0;
+}
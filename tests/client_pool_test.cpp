@@ -0,0 +1,43 @@
+#include <exception>
+#include <optional>
+#include <vector>
+
+#include "geometry_source_uda.h"
+#include "plugin_request.h"
+
+namespace {
+
+/**
+ * Requests to an endpoint reuse its pooled client: the results of each request are freed, not the client
+ */
+void test_client_reused() {
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::UdaGeometrySource source{stats};
+
+    // No GEOM server listens on port 1, so the fetches fail, but each still goes through the endpoint's client
+    const geometry_map_reader::GeometryCacheKey key{"localhost", 1, 1, "/magnetics/pfcoil/d1_upper", 1};
+    std::vector<const uda::Client*> clients;
+    for (int i = 0; i < 2; ++i) {
+        std::optional<geometry_map_reader::GeometryCacheEntry> entry;
+        try {
+            GEOMETRY_CHECK(source.fetch(key, entry) != 0);
+        } catch (const std::exception&) {
+            // The UDA client may report a failed request by throwing
+        }
+        clients.push_back(source.clients().find(key.host, key.port));
+    }
+    GEOMETRY_CHECK(clients[0] != nullptr && clients[0] == clients[1]);
+
+    const auto endpoints = source.clients().stats();
+    GEOMETRY_CHECK(endpoints.size() == 1 && endpoints[0].requests == 2);
+
+    source.clear();
+    GEOMETRY_CHECK(source.clients().find(key.host, key.port) == nullptr);
+}
+
+} // namespace
+
+int main() {
+    test_client_reused();
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <hdf5.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "geometry_plugin.h"
+#include "plugin_request.h"
+
+using geometry_map_reader::test::PluginRequest;
+
+namespace {
+
+void write_dataset(hid_t group, const char* name, hid_t type, const std::vector<hsize_t>& dims, const void* data) {
+    hid_t space = dims.empty() ? H5Screate(H5S_SCALAR) : H5Screate_simple(static_cast<int>(dims.size()), dims.data(),
+                                                                          nullptr);
+    hid_t dataset = H5Dcreate2(group, name, type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Dwrite(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    H5Dclose(dataset);
+    H5Sclose(space);
+}
+
+/**
+ * Write a scalar string attribute, of fixed length or, with variable set, of variable length
+ */
+void write_string_attribute(hid_t object, const char* name, const std::string& value, bool variable = false) {
+    hid_t type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, variable ? H5T_VARIABLE : value.size());
+    hid_t space = H5Screate(H5S_SCALAR);
+    hid_t attribute = H5Acreate2(object, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    const char* data = value.c_str();
+    H5Awrite(attribute, type, variable ? static_cast<const void*>(&data) : data);
+    H5Aclose(attribute);
+    H5Sclose(space);
+    H5Tclose(type);
+}
+
+/**
+ * Write the tree of a coil as a netCDF-4 writer would: r (3 doubles), grid (2 x 3 ints) and the group coil
+ * holding the int turns, with the fixed-length string attribute name and the variable-length string attribute
+ * label, alongside what the file backend skips: a dimension without a coordinate variable, the attributes netCDF
+ * and HDF5 dimension scales add, a compound dataset and a string array.
+ */
+void write_coil(const std::filesystem::path& path, double r0) {
+    std::filesystem::create_directories(path.parent_path());
+    hid_t file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t root = H5Gopen2(file, "/", H5P_DEFAULT);
+
+    const double r[] = {r0, r0 + 0.5, r0 + 1.0};
+    write_dataset(root, "r", H5T_NATIVE_DOUBLE, {3}, r);
+    const int grid[] = {0, 1, 2, 3, 4, 5};
+    write_dataset(root, "grid", H5T_NATIVE_INT, {2, 3}, grid);
+    write_string_attribute(root, "name", "d1_upper");
+    write_string_attribute(root, "label", "upper coil", true);
+
+    const float x[] = {0.0F, 0.0F, 0.0F, 0.0F};
+    write_dataset(root, "x", H5T_NATIVE_FLOAT, {4}, x);
+    hid_t dimension = H5Dopen2(root, "x", H5P_DEFAULT);
+    write_string_attribute(dimension, "NAME", "This is a netCDF dimension but not a netCDF variable.         4");
+    write_string_attribute(dimension, "CLASS", "DIMENSION_SCALE");
+    H5Dclose(dimension);
+    write_string_attribute(root, "_NCProperties", "version=2,netcdf=4.8.1,hdf5=1.10.8");
+
+    struct Flags {
+        int id;
+        double weight;
+    };
+    hid_t compound = H5Tcreate(H5T_COMPOUND, sizeof(Flags));
+    H5Tinsert(compound, "id", HOFFSET(Flags, id), H5T_NATIVE_INT);
+    H5Tinsert(compound, "weight", HOFFSET(Flags, weight), H5T_NATIVE_DOUBLE);
+    const Flags flags[] = {{1, 0.5}, {2, 1.5}};
+    write_dataset(root, "flags", compound, {2}, flags);
+    H5Tclose(compound);
+
+    hid_t strings = H5Tcopy(H5T_C_S1);
+    H5Tset_size(strings, 4);
+    const char names[] = "p1\0\0p2\0\0";
+    write_dataset(root, "names", strings, {2}, names);
+    H5Tclose(strings);
+
+    hid_t coil = H5Gcreate2(root, "coil", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    const int turns = 7;
+    write_dataset(coil, "turns", H5T_NATIVE_INT, {}, &turns);
+    write_string_attribute(coil, "CLASS", "DIMENSION_SCALE");
+    H5Gclose(coil);
+
+    H5Gclose(root);
+    H5Fclose(file);
+}
+
+PluginRequest::Args file_args(const char* signal, const char* key, const char* source = "1") {
+    return {{"backend", "file"}, {"source", source}, {"signal", signal}, {"key", key}};
+}
+
+unsigned long outcome_count(GeometryMapReaderPlugin& plugin, geometry_map_reader::Outcome outcome) {
+    PluginRequest stats{"stats", {}};
+    GEOMETRY_CHECK(plugin.stats(stats.interface()) == 0);
+    return stats.array<unsigned long>("outcome_count")[static_cast<size_t>(outcome)];
+}
+
+/**
+ * Trees are read from <GEOMETRY_FILE_DIR>/<config>/<signal>.h5 or .nc: groups are nodes and datasets and
+ * attributes are leaves, netCDF bookkeeping and unsupported types are skipped, and a file is cached once for all
+ * sources
+ */
+void test_file_backend() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_file_test_" + std::to_string(getpid()));
+    write_coil(directory / "1/magnetics/pfcoil/d1_upper.h5", 1.0);
+    write_coil(directory / "2/magnetics/pfcoil/d1_lower.nc", 3.0);
+    setenv("GEOMETRY_FILE_DIR", directory.c_str(), 1);
+
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    PluginRequest r{"get", file_args("/MAGNETICS/PFCOIL/D1_UPPER", "r")};
+    GEOMETRY_CHECK(plugin.get(r.interface()) == 0);
+    GEOMETRY_CHECK(r.values<double>() == (std::vector<double>{1.0, 1.5, 2.0}));
+
+    PluginRequest grid{"get", file_args("/magnetics/pfcoil/d1_upper", "grid")};
+    GEOMETRY_CHECK(plugin.get(grid.interface()) == 0);
+    GEOMETRY_CHECK(grid.shape() == (std::vector<size_t>{2, 3}));
+    GEOMETRY_CHECK(grid.values<int>() == (std::vector<int>{0, 1, 2, 3, 4, 5}));
+
+    PluginRequest leaves{"get", file_args("/magnetics/pfcoil/d1_upper", "**")};
+    GEOMETRY_CHECK(plugin.get(leaves.interface()) == 0);
+    GEOMETRY_CHECK(leaves.string("resolved_paths") == "grid;r;label;name;coil.turns");
+    GEOMETRY_CHECK(leaves.string("name") == "d1_upper");
+    GEOMETRY_CHECK(leaves.string("label") == "upper coil");
+    GEOMETRY_CHECK(leaves.scalar<int>("coil_turns") == 7);
+
+    // One read of the file serves every source, and requests without one
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::Fetched) == 1);
+    PluginRequest other_source{"get", file_args("/magnetics/pfcoil/d1_upper", "coil.turns", "45272")};
+    GEOMETRY_CHECK(plugin.get(other_source.interface()) == 0);
+    PluginRequest no_source{"get", {{"backend", "file"}, {"signal", "/magnetics/pfcoil/d1_upper"}, {"key", "r"}}};
+    GEOMETRY_CHECK(plugin.get(no_source.interface()) == 0);
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::Fetched) == 1);
+
+    for (const char* skipped : {"x", "x.NAME", "_NCProperties", "coil.CLASS", "flags", "names"}) {
+        PluginRequest missing{"get", file_args("/magnetics/pfcoil/d1_upper", skipped)};
+        GEOMETRY_CHECK(plugin.get(missing.interface()) != 0);
+    }
+
+    PluginRequest nc{"get", {{"backend", "file"}, {"config", "2"}, {"signal", "/magnetics/pfcoil/d1_lower"},
+                             {"key", "r"}}};
+    GEOMETRY_CHECK(plugin.get(nc.interface()) == 0);
+    GEOMETRY_CHECK(nc.values<double>() == (std::vector<double>{3.0, 3.5, 4.0}));
+
+    // Signals only name files under the directory of their config
+    write_coil(directory / "secret.h5", 5.0);
+    for (const char* signal : {"/../secret", "/magnetics/pfcoil/..", "/magnetics/pfcoil/d1_lower", ""}) {
+        PluginRequest rejected{"get", file_args(signal, "r")};
+        GEOMETRY_CHECK(plugin.get(rejected.interface()) != 0);
+    }
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::Fetched) == 2);
+
+    plugin.reset(init.interface());
+    unsetenv("GEOMETRY_FILE_DIR");
+    std::filesystem::remove_all(directory);
+}
+
+} // namespace
+
+int main() {
+    test_file_backend();
+    return 0;
+}
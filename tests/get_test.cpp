@@ -0,0 +1,696 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "geometry_plugin.h"
+#include "geometry_return.h"
+#include "geometry_source_memory.h"
+#include "plugin_request.h"
+
+using geometry_map_reader::test::PluginRequest;
+
+namespace {
+
+std::shared_ptr<const geometry_map_reader::MemoryTreeNode> make_coil(double r0, int turns) {
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coil = tree->add_child("coil");
+    const double r[] = {r0, r0 + 0.5, r0 + 1.0};
+    coil.add_array<double>("r", r, {3});
+    coil.add_scalar<int>("turns", turns);
+    coil.add_string("name", "d1_upper");
+    return tree;
+}
+
+PluginRequest::Args get_args(const char* source, const char* key, PluginRequest::Args args = {}) {
+    args.insert(args.end(), {{"source", source}, {"signal", "/MAGNETICS/PFCOIL/D1_UPPER"}, {"key", key}});
+    if (std::none_of(args.begin(), args.end(), [](const auto& arg) { return arg.first == "host"; })) {
+        args.insert(args.end(), {{"host", "localhost"}, {"port", "56565"}});
+    }
+    return args;
+}
+
+/**
+ * Tree of the leaves the return option tests read, each holding its row-major element index: a.v (6 doubles),
+ * a.m (3 x 4 ints) and a.c (2 x 3 x 4 doubles), with the int scalar a.s = 7, the string a.name and a.f, doubles
+ * that do not convert exactly to int32
+ */
+std::shared_ptr<const geometry_map_reader::MemoryTreeNode> make_arrays() {
+    std::vector<double> values(24);
+    std::vector<int> ints(12);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<double>(i);
+    }
+    for (size_t i = 0; i < ints.size(); ++i) {
+        ints[i] = static_cast<int>(i);
+    }
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& a = tree->add_child("a");
+    a.add_array<double>("v", gsl::span<const double>{values.data(), 6}, {6});
+    a.add_array<int>("m", ints, {3, 4});
+    a.add_array<double>("c", values, {2, 3, 4});
+    a.add_scalar<int>("s", 7);
+    a.add_string("name", "d1_upper");
+    const double fractions[] = {0.5, 1.5, 2.5, -0.5, -1.5, 1e12, -1e12, 2.4};
+    a.add_array<double>("f", fractions, {8});
+    return tree;
+}
+
+/**
+ * A plugin serving the tree of make_arrays as source 1
+ */
+class ArrayPlugin {
+  public:
+    ArrayPlugin() {
+        plugin_.init(init_.interface());
+        memory_.add(1, "/magnetics/pfcoil/d1_upper", 1, make_arrays());
+        plugin_.set_source(geometry_map_reader::GeometryBackend::Uda, &memory_);
+    }
+    ArrayPlugin(const ArrayPlugin&) = delete;
+    ArrayPlugin& operator=(const ArrayPlugin&) = delete;
+    ~ArrayPlugin() { plugin_.reset(init_.interface()); }
+
+    int get(PluginRequest& request) { return plugin_.get(request.interface()); }
+
+  private:
+    GeometryMapReaderPlugin plugin_;
+    PluginRequest init_{"init", {}};
+    geometry_map_reader::PluginStats stats_;
+    geometry_map_reader::MemoryGeometrySource memory_{stats_};
+};
+
+/**
+ * Serves the trees of a memory source from every endpoint but an unreachable one
+ */
+class EndpointSource final : public geometry_map_reader::GeometrySource {
+  public:
+    EndpointSource(geometry_map_reader::GeometrySource& source, std::string down)
+        : source_{source}, down_{std::move(down)} {}
+
+    int fetch(const geometry_map_reader::GeometryCacheKey& key,
+              std::optional<geometry_map_reader::GeometryCacheEntry>& entry) override {
+        return key.host == down_ ? 1 : source_.fetch(key, entry);
+    }
+
+  private:
+    geometry_map_reader::GeometrySource& source_;
+    std::string down_;
+};
+
+/**
+ * @return the number of requests with the outcome, as reported by GEOMETRY::stats
+ */
+unsigned long outcome_count(GeometryMapReaderPlugin& plugin, geometry_map_reader::Outcome outcome) {
+    PluginRequest stats{"stats", {}};
+    GEOMETRY_CHECK(plugin.stats(stats.interface()) == 0);
+    return stats.array<unsigned long>("outcome_count")[static_cast<size_t>(outcome)];
+}
+
+/**
+ * GEOMETRY::get serves the trees of a source set with set_source through the GeometrySource interface, keyed by
+ * source, signal and config
+ */
+void test_memory_source() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, make_coil(1.0, 5));
+    memory.add(2, "/magnetics/pfcoil/d1_upper", 1, make_coil(2.0, 7));
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    PluginRequest array{"get", get_args("1", "coil.r")};
+    GEOMETRY_CHECK(plugin.get(array.interface()) == 0);
+    GEOMETRY_CHECK(array.data_block().rank == 1 && array.data_block().data_n == 3);
+    GEOMETRY_CHECK(reinterpret_cast<const double*>(array.data_block().data)[2] == 2.0);
+
+    PluginRequest batch{"get", get_args("2", "coil.turns;coil.name")};
+    GEOMETRY_CHECK(plugin.get(batch.interface()) == 0);
+    GEOMETRY_CHECK(batch.scalar<int>("coil_turns") == 7);
+    GEOMETRY_CHECK(batch.string("coil_name") == "d1_upper");
+    GEOMETRY_CHECK(batch.string("resolved_paths") == "coil.turns;coil.name");
+
+    PluginRequest missing{"get", get_args("3", "coil.r")};
+    GEOMETRY_CHECK(plugin.get(missing.interface()) != 0);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * Only keys missing from the tree are remembered as failed: a key that can not be returned with one op or slice
+ * is still returned without it
+ */
+void test_negative_cache() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, make_coil(1.0, 5));
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    PluginRequest reduced{"get", get_args("1", "coil.name;coil.r", {{"op", "sum"}})};
+    GEOMETRY_CHECK(plugin.get(reduced.interface()) != 0);
+    PluginRequest batch{"get", get_args("1", "coil.name;coil.r")};
+    GEOMETRY_CHECK(plugin.get(batch.interface()) == 0);
+    GEOMETRY_CHECK(batch.string("coil_name") == "d1_upper");
+
+    PluginRequest sliced{"get", get_args("1", "coil.turns[0:1];coil.r")};
+    GEOMETRY_CHECK(plugin.get(sliced.interface()) != 0);
+    PluginRequest empty{"get", get_args("1", "coil.r[0:0];coil.turns", {{"op", "mean"}})};
+    GEOMETRY_CHECK(plugin.get(empty.interface()) != 0);
+    PluginRequest unreduced{"get", get_args("1", "coil.r[0:0];coil.turns")};
+    GEOMETRY_CHECK(plugin.get(unreduced.interface()) == 0);
+
+    // Missing keys are remembered
+    PluginRequest missing{"get", get_args("1", "coil.dr;coil.r")};
+    GEOMETRY_CHECK(plugin.get(missing.interface()) != 0);
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::NegativeHit) == 0);
+    PluginRequest retried{"get", get_args("1", "coil.dr;coil.r")};
+    GEOMETRY_CHECK(plugin.get(retried.interface()) != 0);
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::NegativeHit) == 1);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * A signal that failed to be fetched from one endpoint is still fetched from others
+ */
+void test_fetch_error_per_endpoint() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, make_coil(1.0, 5));
+    EndpointSource endpoints{memory, "down"};
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &endpoints);
+
+    PluginRequest down{"get", get_args("1", "coil.turns", {{"host", "down"}, {"port", "56565"}})};
+    GEOMETRY_CHECK(plugin.get(down.interface()) != 0);
+    PluginRequest up{"get", get_args("1", "coil.turns", {{"host", "up"}, {"port", "56565"}})};
+    GEOMETRY_CHECK(plugin.get(up.interface()) == 0);
+    GEOMETRY_CHECK(*reinterpret_cast<const int*>(up.data_block().data) == 5);
+
+    PluginRequest retried{"get", get_args("1", "coil.turns", {{"host", "down"}, {"port", "56565"}})};
+    GEOMETRY_CHECK(plugin.get(retried.interface()) != 0);
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::NegativeHit) == 1);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * A request for a cached tree times its cache probe and key lookup once each
+ */
+void test_phases_timed_once() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, make_coil(1.0, 5));
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    // A miss times the insertion into the cache apart from the lookup that follows it
+    PluginRequest fetched{"get", get_args("1", "coil.turns")};
+    GEOMETRY_CHECK(plugin.get(fetched.interface()) == 0);
+    PluginRequest miss{"stats", {}};
+    GEOMETRY_CHECK(plugin.stats(miss.interface()) == 0);
+    const auto* miss_counts = miss.array<unsigned long>("count");
+    GEOMETRY_CHECK(miss_counts[static_cast<size_t>(geometry_map_reader::Phase::CacheProbe)] == 1);
+    GEOMETRY_CHECK(miss_counts[static_cast<size_t>(geometry_map_reader::Phase::StoreSave)] == 0);
+    GEOMETRY_CHECK(miss_counts[static_cast<size_t>(geometry_map_reader::Phase::CacheInsert)] == 1);
+    GEOMETRY_CHECK(miss_counts[static_cast<size_t>(geometry_map_reader::Phase::Lookup)] == 1);
+
+    PluginRequest reset{"stats", {{"reset", ""}}};
+    GEOMETRY_CHECK(plugin.stats(reset.interface()) == 0);
+
+    PluginRequest cached{"get", get_args("1", "coil.turns")};
+    GEOMETRY_CHECK(plugin.get(cached.interface()) == 0);
+    PluginRequest report{"stats", {}};
+    GEOMETRY_CHECK(plugin.stats(report.interface()) == 0);
+    const auto* counts = report.array<unsigned long>("count");
+    GEOMETRY_CHECK(counts[static_cast<size_t>(geometry_map_reader::Phase::CacheProbe)] == 1);
+    GEOMETRY_CHECK(counts[static_cast<size_t>(geometry_map_reader::Phase::CacheInsert)] == 0);
+    GEOMETRY_CHECK(counts[static_cast<size_t>(geometry_map_reader::Phase::Lookup)] == 1);
+    GEOMETRY_CHECK(counts[static_cast<size_t>(geometry_map_reader::Phase::Total)] == 1);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * GEOMETRY::help documents each plugin function
+ */
+void test_help() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest help{"help", {}};
+    GEOMETRY_CHECK(plugin.help(help.interface()) == 0);
+    const std::string text{help.data_block().data};
+    for (const char* function : {"get(", "preload(", "invalidate(", "region(", "nearest(", "inside(", "wallmask(",
+                                 "stats(", "connections(", "dumptrace("}) {
+        GEOMETRY_CHECK(text.find(function) != std::string::npos);
+    }
+}
+
+/**
+ * An empty array or string is returned empty, not as a failure to copy it
+ */
+void test_empty_array() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coil = tree->add_child("coil");
+    coil.add_array<double>("r", {}, {0});
+    coil.add_string("name", std::string_view{});
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, tree);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    PluginRequest empty{"get", get_args("1", "coil.r")};
+    GEOMETRY_CHECK(plugin.get(empty.interface()) == 0);
+    GEOMETRY_CHECK(empty.data_block().data_n == 0);
+
+    PluginRequest name{"get", get_args("1", "coil.name;coil.r")};
+    GEOMETRY_CHECK(plugin.get(name.interface()) == 0);
+    GEOMETRY_CHECK(name.string("coil_name").empty());
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * Slices select elements with Python semantics, and a slice that does not fit the leaf fails the request
+ */
+void test_slices() {
+    ArrayPlugin plugin;
+    auto check = [&](const char* key, const std::vector<size_t>& shape, const std::vector<double>& values) {
+        PluginRequest get{"get", get_args("1", key)};
+        GEOMETRY_CHECK(plugin.get(get) == 0);
+        GEOMETRY_CHECK(get.shape() == shape);
+        GEOMETRY_CHECK(get.values<double>() == values);
+    };
+    check("a.v[1:4]", {3}, {1, 2, 3});
+    check("a.v[-2:]", {2}, {4, 5});
+    check("a.v[:-4]", {2}, {0, 1});
+    check("a.v[::-1]", {6}, {5, 4, 3, 2, 1, 0});
+    check("a.v[4:1:-2]", {2}, {4, 2});
+    check("a.v[::4]", {2}, {0, 4});
+    check("a.v[-100:100]", {6}, {0, 1, 2, 3, 4, 5});
+    check("a.v[10:]", {0}, {});
+    check("a.v[4:1]", {0}, {});
+
+    // Indexing drops the dimension, down to a scalar
+    check("a.v[2]", {}, {2});
+    check("a.v[-1]", {}, {5});
+    check("a.c[:,1,::2]", {2, 2}, {4, 6, 16, 18});
+    check("a.c[1][2]", {4}, {20, 21, 22, 23});
+    check("a.c[1,-1,::-3]", {2}, {23, 20});
+    check("a.c[0,1,2]", {}, {6});
+    check("a.c[1:]", {1, 3, 4}, {12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23});
+
+    PluginRequest ints{"get", get_args("1", "a.m[1][::-1]")};
+    GEOMETRY_CHECK(plugin.get(ints) == 0);
+    GEOMETRY_CHECK(ints.data_block().data_type == UDA_TYPE_INT);
+    GEOMETRY_CHECK(ints.values<int>() == std::vector<int>({7, 6, 5, 4}));
+
+    // Out of range indices, more slices than dimensions, malformed slices and slices of strings or scalars
+    for (const char* key : {"a.v[6]", "a.v[-7]", "a.v[0,0]", "a.c[0][0][0][0]", "a.v[1:2", "a.v[a]", "a.v[::0]",
+                            "a.v[1]x", "a.v[1:2:3:4]", "a.v[]", "a.name[0:1]", "a.s[0]"}) {
+        PluginRequest get{"get", get_args("1", key)};
+        GEOMETRY_CHECK(plugin.get(get) != 0);
+    }
+
+    // Slices of several keys in one request
+    PluginRequest batch{"get", get_args("1", "a.v[::2];a.c[1,2]")};
+    GEOMETRY_CHECK(plugin.get(batch) == 0);
+    const double* v = batch.array<double>("a_v");
+    GEOMETRY_CHECK(v[0] == 0.0 && v[1] == 2.0 && v[2] == 4.0);
+    GEOMETRY_CHECK(batch.array<double>("a_c")[3] == 23.0);
+    GEOMETRY_CHECK(batch.string("resolved_paths") == "a.v[::2];a.c[1,2]");
+}
+
+/**
+ * @return the elements of a row-major array in Fortran (column-major) order, ie. row-major with the axes reversed
+ */
+std::vector<double> fortran_order(const std::vector<double>& values, const std::vector<size_t>& shape) {
+    std::vector<double> reordered;
+    std::vector<size_t> index(shape.size(), 0);
+    for (size_t n = 0; n < values.size(); ++n) {
+        size_t offset = 0;
+        for (size_t dim = 0; dim < shape.size(); ++dim) {
+            offset = offset * shape[dim] + index[dim];
+        }
+        reordered.push_back(values[offset]);
+        // Step the first axis fastest
+        for (size_t dim = 0; dim < shape.size() && ++index[dim] == shape[dim]; ++dim) {
+            index[dim] = 0;
+        }
+    }
+    return reordered;
+}
+
+/**
+ * order=F returns arrays in Fortran element order with their dimensions reversed, whole or sliced
+ */
+void test_fortran_order() {
+    ArrayPlugin plugin;
+    auto check = [&](const char* key, const std::vector<size_t>& c_shape, const std::vector<double>& c_values) {
+        PluginRequest c_order{"get", get_args("1", key)};
+        GEOMETRY_CHECK(plugin.get(c_order) == 0);
+        GEOMETRY_CHECK(c_order.shape() == c_shape);
+        GEOMETRY_CHECK(c_order.values<double>() == c_values);
+
+        PluginRequest f_order{"get", get_args("1", key, {{"order", "F"}})};
+        GEOMETRY_CHECK(plugin.get(f_order) == 0);
+        GEOMETRY_CHECK(f_order.shape() == std::vector<size_t>(c_shape.rbegin(), c_shape.rend()));
+        GEOMETRY_CHECK(f_order.values<double>() == fortran_order(c_values, c_shape));
+    };
+
+    std::vector<double> c(24);
+    for (size_t i = 0; i < c.size(); ++i) {
+        c[i] = static_cast<double>(i);
+    }
+    check("a.c", {2, 3, 4}, c);
+    check("a.c[:,1:,::2]", {2, 2, 2}, {4, 6, 8, 10, 16, 18, 20, 22});
+    check("a.c[1]", {3, 4}, {12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23});
+    check("a.c[:,::-1,3]", {2, 3}, {11, 7, 3, 23, 19, 15});
+    check("a.v[1:3]", {2}, {1, 2});
+
+    // Known transposes, and conversion to a dtype in the same pass
+    PluginRequest whole{"get", get_args("1", "a.m", {{"order", "F"}})};
+    GEOMETRY_CHECK(plugin.get(whole) == 0);
+    GEOMETRY_CHECK(whole.shape() == std::vector<size_t>({4, 3}));
+    GEOMETRY_CHECK(whole.values<int>() == std::vector<int>({0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11}));
+    PluginRequest sliced{"get", get_args("1", "a.m[1:,::3]", {{"order", "F"}, {"dtype", "float64"}})};
+    GEOMETRY_CHECK(plugin.get(sliced) == 0);
+    GEOMETRY_CHECK(sliced.shape() == std::vector<size_t>({2, 2}));
+    GEOMETRY_CHECK(sliced.values<double>() == std::vector<double>({4, 8, 7, 11}));
+
+    // order=F applies to each member of a batch
+    PluginRequest batch{"get", get_args("1", "a.m;a.v", {{"order", "F"}})};
+    GEOMETRY_CHECK(plugin.get(batch) == 0);
+    const int* m = batch.array<int>("a_m");
+    GEOMETRY_CHECK(m[1] == 4 && m[3] == 1 && m[11] == 11);
+
+    PluginRequest bad{"get", get_args("1", "a.m", {{"order", "X"}})};
+    GEOMETRY_CHECK(plugin.get(bad) != 0);
+}
+
+/**
+ * dtype converts numeric leaves, rounding half to even and saturating at the limits of int32, and report_loss
+ * describes the values the conversion changed
+ */
+void test_dtype() {
+    ArrayPlugin plugin;
+
+    PluginRequest ints{"get", get_args("1", "a.f", {{"dtype", "int32"}})};
+    GEOMETRY_CHECK(plugin.get(ints) == 0);
+    GEOMETRY_CHECK(ints.data_block().data_type == UDA_TYPE_INT);
+    GEOMETRY_CHECK(ints.values<int>() == std::vector<int>({0, 2, 2, 0, -2, INT32_MAX, INT32_MIN, 2}));
+    GEOMETRY_CHECK(std::string{ints.data_block().data_desc}.empty());
+
+    PluginRequest loss{"get", get_args("1", "a.f", {{"dtype", "int32"}, {"report_loss", ""}})};
+    GEOMETRY_CHECK(plugin.get(loss) == 0);
+    GEOMETRY_CHECK(loss.values<int>() == ints.values<int>());
+    GEOMETRY_CHECK(std::string{loss.data_block().data_desc} ==
+                   "converted float64 to int32: 8 of 8 values changed, max abs error 9.97853e+11");
+
+    PluginRequest exact{"get", get_args("1", "a.v[1:4]", {{"dtype", "int32"}, {"report_loss", ""}})};
+    GEOMETRY_CHECK(plugin.get(exact) == 0);
+    GEOMETRY_CHECK(exact.values<int>() == std::vector<int>({1, 2, 3}));
+    GEOMETRY_CHECK(std::string{exact.data_block().data_desc} ==
+                   "converted float64 to int32: 0 of 3 values changed, max abs error 0");
+
+    PluginRequest floats{"get", get_args("1", "a.m[2]", {{"dtype", "float32"}})};
+    GEOMETRY_CHECK(plugin.get(floats) == 0);
+    GEOMETRY_CHECK(floats.data_block().data_type == UDA_TYPE_FLOAT);
+    GEOMETRY_CHECK(floats.values<float>() == std::vector<float>({8, 9, 10, 11}));
+
+    PluginRequest scalar{"get", get_args("1", "a.s", {{"dtype", "float64"}, {"report_loss", ""}})};
+    GEOMETRY_CHECK(plugin.get(scalar) == 0);
+    GEOMETRY_CHECK(scalar.data_block().data_type == UDA_TYPE_DOUBLE && scalar.values<double>()[0] == 7.0);
+    GEOMETRY_CHECK(std::string{scalar.data_block().data_desc} ==
+                   "converted int32 to float64: 0 of 1 values changed, max abs error 0");
+
+    // Without a conversion there is no loss to report
+    PluginRequest same{"get", get_args("1", "a.v", {{"dtype", "float64"}, {"report_loss", ""}})};
+    GEOMETRY_CHECK(plugin.get(same) == 0);
+    GEOMETRY_CHECK(std::string{same.data_block().data_desc}.empty());
+
+    // Batch members carry the loss in their description
+    PluginRequest batch{"get", get_args("1", "a.f[:3];a.s", {{"dtype", "int32"}, {"report_loss", ""}})};
+    GEOMETRY_CHECK(plugin.get(batch) == 0);
+    const int* f = batch.array<int>("a_f");
+    GEOMETRY_CHECK(f[0] == 0 && f[1] == 2 && f[2] == 2 && batch.scalar<int>("a_s") == 7);
+    GEOMETRY_CHECK(std::string{batch.member("a_f")->desc}.find("3 of 3 values changed") != std::string::npos);
+
+    for (const char* dtype : {"float16", "int64", "double", ""}) {
+        PluginRequest unknown{"get", get_args("1", "a.v", {{"dtype", dtype}})};
+        GEOMETRY_CHECK(plugin.get(unknown) != 0);
+    }
+}
+
+/**
+ * op returns a reduction of the (sliced) leaf values, and fails when there is nothing to reduce
+ */
+void test_reductions() {
+    ArrayPlugin plugin;
+    auto reduce = [&](const char* key, const char* op, PluginRequest::Args extra = {}) {
+        extra.emplace_back("op", op);
+        auto request = std::make_unique<PluginRequest>("get", get_args("1", key, std::move(extra)));
+        GEOMETRY_CHECK(plugin.get(*request) == 0);
+        return request;
+    };
+
+    GEOMETRY_CHECK(reduce("a.v", "sum")->values<double>() == std::vector<double>({15}));
+    GEOMETRY_CHECK(reduce("a.v", "min")->values<double>() == std::vector<double>({0}));
+    GEOMETRY_CHECK(reduce("a.v", "max")->values<double>() == std::vector<double>({5}));
+    GEOMETRY_CHECK(reduce("a.v", "mean")->values<double>() == std::vector<double>({2.5}));
+    GEOMETRY_CHECK(reduce("a.v", "range")->values<double>() == std::vector<double>({0, 5}));
+    GEOMETRY_CHECK(reduce("a.v", "argmin")->values<long long>() == std::vector<long long>({0}));
+    GEOMETRY_CHECK(reduce("a.v", "argmax")->values<long long>() == std::vector<long long>({5}));
+
+    // Integer leaves sum to long long and keep their type for min, max and range
+    auto sum = reduce("a.m", "sum");
+    GEOMETRY_CHECK(sum->data_block().data_type == UDA_TYPE_LONG64 && sum->values<long long>()[0] == 66);
+    auto range = reduce("a.m", "range");
+    GEOMETRY_CHECK(range->data_block().data_type == UDA_TYPE_INT);
+    GEOMETRY_CHECK(range->shape() == std::vector<size_t>({2}) && range->values<int>() == std::vector<int>({0, 11}));
+    GEOMETRY_CHECK(reduce("a.m", "mean")->values<double>() == std::vector<double>({5.5}));
+
+    // Sliced leaves reduce the selected values, with indices into the slice
+    GEOMETRY_CHECK(reduce("a.v[::2]", "sum")->values<double>() == std::vector<double>({6}));
+    GEOMETRY_CHECK(reduce("a.v[::-1]", "argmax")->values<long long>() == std::vector<long long>({0}));
+    GEOMETRY_CHECK(reduce("a.c[1,:,2]", "max")->values<double>() == std::vector<double>({22}));
+    GEOMETRY_CHECK(reduce("a.m[:,1]", "mean")->values<double>() == std::vector<double>({5}));
+    GEOMETRY_CHECK(reduce("a.f", "argmin")->values<long long>() == std::vector<long long>({6}));
+    GEOMETRY_CHECK(reduce("a.s", "sum")->values<long long>() == std::vector<long long>({7}));
+    GEOMETRY_CHECK(reduce("a.v[2:2]", "sum")->values<double>() == std::vector<double>({0}));
+
+    // Each batch member is reduced
+    auto batch = reduce("a.v;a.m[0]", "max");
+    GEOMETRY_CHECK(batch->scalar<double>("a_v") == 5.0 && batch->scalar<int>("a_m") == 3);
+
+    // Nothing to reduce: an empty slice (other than for sum), a string or an unknown op
+    for (const auto& [key, op] : {std::pair{"a.v[2:2]", "mean"}, std::pair{"a.v[2:2]", "min"},
+                                  std::pair{"a.v[2:2]", "argmax"}, std::pair{"a.v[2:2]", "range"},
+                                  std::pair{"a.name", "sum"}, std::pair{"a.name", "max"}, std::pair{"a.v", "median"},
+                                  std::pair{"a.name;a.v", "min"}}) {
+        PluginRequest failed{"get", get_args("1", key, {{"op", op}})};
+        GEOMETRY_CHECK(plugin.get(failed) != 0);
+    }
+    PluginRequest with_dtype{"get", get_args("1", "a.v", {{"op", "sum"}, {"dtype", "int32"}})};
+    GEOMETRY_CHECK(plugin.get(with_dtype) != 0);
+}
+
+/**
+ * Glob patterns expand to the matching leaves in tree order, each returned once, and a pattern matching no leaf
+ * fails like a missing key
+ */
+void test_key_patterns() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coils = tree->add_child("coils");
+    auto& p1 = coils.add_child("p1");
+    p1.add_scalar<int>("turns", 1);
+    const double r[] = {1.0, 2.0};
+    p1.add_child("geometry").add_array<double>("r", r, {2});
+    coils.add_child("p2").add_scalar<int>("turns", 2);
+    coils.add_child("p10").add_scalar<int>("turns", 10);
+    const double wall_r[] = {3.0, 4.0, 5.0};
+    tree->add_child("wall").add_array<double>("r", wall_r, {3});
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, tree);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    auto resolve = [&](const char* keys) {
+        PluginRequest get{"get", get_args("1", keys)};
+        GEOMETRY_CHECK(plugin.get(get.interface()) == 0);
+        return get.string("resolved_paths");
+    };
+    GEOMETRY_CHECK(resolve("coils.*.turns") == "coils.p1.turns;coils.p2.turns;coils.p10.turns");
+    GEOMETRY_CHECK(resolve("coils.p?.turns") == "coils.p1.turns;coils.p2.turns");
+    GEOMETRY_CHECK(resolve("coils.p1?.turns") == "coils.p10.turns");
+    GEOMETRY_CHECK(resolve("*.r") == "wall.r");
+    GEOMETRY_CHECK(resolve("**.r") == "coils.p1.geometry.r;wall.r");
+    GEOMETRY_CHECK(resolve("coils.**") == "coils.p1.turns;coils.p1.geometry.r;coils.p2.turns;coils.p10.turns");
+    GEOMETRY_CHECK(resolve("wall.r;coils.*.turns") == "wall.r;coils.p1.turns;coils.p2.turns;coils.p10.turns");
+    GEOMETRY_CHECK(resolve("coils.p2.turns;coils.*.turns") == "coils.p2.turns;coils.p1.turns;coils.p10.turns");
+    GEOMETRY_CHECK(resolve("**.r[1:]") == "coils.p1.geometry.r[1:];wall.r[1:]");
+
+    PluginRequest values{"get", get_args("1", "coils.*.turns;**.r[-1]")};
+    GEOMETRY_CHECK(plugin.get(values.interface()) == 0);
+    GEOMETRY_CHECK(values.scalar<int>("coils_p1_turns") == 1 && values.scalar<int>("coils_p10_turns") == 10);
+    GEOMETRY_CHECK(values.scalar<double>("coils_p1_geometry_r") == 2.0 && values.scalar<double>("wall_r") == 5.0);
+
+    // Patterns matching no leaf are remembered as not found
+    PluginRequest missing{"get", get_args("1", "coils.*.dz")};
+    GEOMETRY_CHECK(plugin.get(missing.interface()) != 0);
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::KeyNotFound) == 1);
+    PluginRequest retried{"get", get_args("1", "coils.*.dz")};
+    GEOMETRY_CHECK(plugin.get(retried.interface()) != 0);
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::NegativeHit) == 1);
+    PluginRequest unmatched{"get", get_args("1", "coils.*.dz;coils.p9.turns")};
+    GEOMETRY_CHECK(plugin.get(unmatched.interface()) != 0);
+
+    // A slice applies to every leaf the pattern matches, so it fails on scalars
+    PluginRequest sliced{"get", get_args("1", "coils.*.turns[0]")};
+    GEOMETRY_CHECK(plugin.get(sliced.interface()) != 0);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * Each batch member has its own name: repeated keys are returned once, and keys that would share a member name
+ * or whose name is too long fail the request
+ */
+void test_member_names() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    const double r[] = {1.0, 2.0, 3.0, 4.0};
+    auto& a = tree->add_child("a");
+    a.add_array<double>("r", r, {4});
+    a.add_scalar<int>("b_c", 1);
+    const std::string long_name(300, 'x');
+    a.add_scalar<int>(long_name, 3);
+    tree->add_child("a_b").add_scalar<int>("c", 2);
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, tree);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    PluginRequest repeated{"get", get_args("1", "a.r[0:2];a.r[0:2]")};
+    GEOMETRY_CHECK(plugin.get(repeated.interface()) == 0);
+    GEOMETRY_CHECK(repeated.string("resolved_paths") == "a.r[0:2]");
+    GEOMETRY_CHECK(repeated.array<double>("a_r")[1] == 2.0);
+
+    const std::string long_key = "a.b_c;a." + long_name;
+    for (const char* keys : {"a.r[0:2];a.r[2:4]", "a.r;a.r[1]", "a.b_c;a_b.c", "a_b.*;a.b_c", long_key.c_str()}) {
+        PluginRequest clash{"get", get_args("1", keys)};
+        GEOMETRY_CHECK(plugin.get(clash.interface()) != 0);
+    }
+    GEOMETRY_CHECK(outcome_count(plugin, geometry_map_reader::Outcome::KeyNotFound) == 0);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * copy_leaf tells a copy that can not be allocated from slices that do not fit, and GEOMETRY::get raises the
+ * former as an error of its own
+ */
+void test_copy_errors() {
+    // A leaf claiming far more elements than can be allocated, of which only the first few are ever read
+    geometry_map_reader::MemoryTreeNode node{"data"};
+    const size_t huge = size_t{1} << 50;
+    auto* data = static_cast<double*>(node.add_atomic("r", UDA_TYPE_DOUBLE, {huge}, 4 * sizeof(double)));
+    data[1] = 1.5;
+    const geometry_map_reader::GeometryLeaf& leaf = node.atomics[0].second;
+
+    geometry_map_reader::ReturnOptions options;
+    double* out = nullptr;
+    std::vector<size_t> shape;
+    GEOMETRY_CHECK(geometry_map_reader::copy_leaf<double>(data, leaf, options, out, shape) ==
+                   geometry_map_reader::copy_leaf_alloc_error);
+    imas_json_plugin::array_kernels::ConversionLoss loss;
+    float* converted = nullptr;
+    GEOMETRY_CHECK(geometry_map_reader::copy_leaf<float>(data, leaf, options, converted, shape, &loss) ==
+                   geometry_map_reader::copy_leaf_alloc_error);
+
+    options.slices = {{0, 2}};
+    GEOMETRY_CHECK(geometry_map_reader::copy_leaf<double>(data, leaf, options, out, shape) == 0);
+    GEOMETRY_CHECK(shape == std::vector<size_t>{2} && out[1] == 1.5);
+    free(out);
+    options.slices = {{0, 2}, {0, 2}};
+    GEOMETRY_CHECK(geometry_map_reader::copy_leaf<double>(data, leaf, options, out, shape) ==
+                   geometry_map_reader::copy_leaf_slices_error);
+
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coil = tree->add_child("coil");
+    coil.add_atomic("r", UDA_TYPE_DOUBLE, {huge}, 4 * sizeof(double));
+    coil.add_scalar<int>("turns", 3);
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/magnetics/pfcoil/d1_upper", 1, tree);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    for (const char* key : {"coil.r[0:2]", "coil.r[0:2];coil.turns"}) {
+        PluginRequest sliced{"get", get_args("1", key)};
+        GEOMETRY_CHECK(plugin.get(sliced.interface()) == 0);
+    }
+    for (const char* key : {"coil.r[0:2][0]", "coil.r[0:2][0];coil.turns"}) {
+        PluginRequest bad_slices{"get", get_args("1", key)};
+        GEOMETRY_CHECK(plugin.get(bad_slices.interface()) == 1);
+    }
+    for (const char* key : {"coil.r", "coil.r;coil.turns"}) {
+        PluginRequest too_large{"get", get_args("1", key)};
+        int err = plugin.get(too_large.interface());
+        GEOMETRY_CHECK(err != 0 && err != 1);
+    }
+    PluginRequest reduced{"get", get_args("1", "coil.r[:]", {{"op", "sum"}})};
+    int err = plugin.get(reduced.interface());
+    GEOMETRY_CHECK(err != 0 && err != 1);
+
+    plugin.reset(init.interface());
+}
+
+} // namespace
+
+int main() {
+    test_memory_source();
+    test_negative_cache();
+    test_fetch_error_per_endpoint();
+    test_phases_timed_once();
+    test_help();
+    test_empty_array();
+    test_slices();
+    test_fortran_order();
+    test_dtype();
+    test_reductions();
+    test_key_patterns();
+    test_member_names();
+    test_copy_errors();
+    return 0;
+}
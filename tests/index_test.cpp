@@ -0,0 +1,80 @@
+#include <string_view>
+
+#include "geometry_index.h"
+#include "plugin_request.h"
+
+namespace {
+
+/**
+ * key_matches: '*' stays within one path element, '**' crosses elements and '?' matches one character but '.'
+ */
+void test_key_matches() {
+    struct Case {
+        std::string_view pattern;
+        std::string_view key;
+        bool matches;
+    };
+    const Case cases[] = {
+        {"coil.r", "coil.r", true},
+        {"coil.r", "coil.z", false},
+        {"coil.r", "coil.rr", false},
+        {"coil.rr", "coil.r", false},
+        {"", "", true},
+        {"", "coil", false},
+        {"*", "", true},
+        {"*", "coil", true},
+        {"*", "coil.r", false},
+        {"*.r", "coil.r", true},
+        {"*.r", ".r", true},
+        {"*.r", "coils.p1.r", false},
+        {"coil.*", "coil.r", true},
+        {"coil.*", "coil.", true},
+        {"coil.*", "coil", false},
+        {"coils.*.turns", "coils.p1.turns", true},
+        {"coils.*.turns", "coils.p1.geometry.turns", false},
+        {"c*l.r", "coil.r", true},
+        {"c*l.r", "cl.r", true},
+        {"c*l.r", "coil.z.l.r", false},
+        {"*o*i*", "coil", true},
+        {"**", "", true},
+        {"**", "coils.p1.geometry.r", true},
+        {"**.r", "coils.p1.geometry.r", true},
+        {"**.r", "wall.r", true},
+        {"**.r", "r", false},
+        {"**.r", "wall.rz", false},
+        {"coils.**", "coils.p1.turns", true},
+        {"coils.**", "coil.p1", false},
+        {"coils.**.r", "coils.r", false},
+        {"coils.**.r", "coils.p1.r", true},
+        {"coils.**.r", "coils.p1.geometry.r", true},
+        {"***", "a.b", true},
+        {"?", "r", true},
+        {"?", ".", false},
+        {"?", "", false},
+        {"?", "rz", false},
+        {"p?.turns", "p1.turns", true},
+        {"p?.turns", "p10.turns", false},
+        {"p??.turns", "p10.turns", true},
+        {"coil?r", "coil.r", false},
+        {"**?", "a.b", true},
+        {"*?", "", false},
+    };
+    for (const auto& [pattern, key, matches] : cases) {
+        if (geometry_map_reader::key_matches(pattern, key) != matches) {
+            std::fprintf(stderr, "key_matches(\"%.*s\", \"%.*s\") != %d\n", static_cast<int>(pattern.size()),
+                         pattern.data(), static_cast<int>(key.size()), key.data(), matches);
+            std::exit(1);
+        }
+    }
+
+    GEOMETRY_CHECK(geometry_map_reader::is_key_pattern("coils.*.turns"));
+    GEOMETRY_CHECK(geometry_map_reader::is_key_pattern("coils.p?"));
+    GEOMETRY_CHECK(!geometry_map_reader::is_key_pattern("coils.p1.turns"));
+}
+
+} // namespace
+
+int main() {
+    test_key_matches();
+    return 0;
+}
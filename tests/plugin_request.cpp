@@ -0,0 +1,106 @@
+#include "plugin_request.h"
+
+#include <clientserver/initStructs.h>
+#include <structures/struct.h>
+
+namespace geometry_map_reader::test {
+
+namespace {
+
+char* copy_string(const std::string& value) {
+    auto copy = static_cast<char*>(std::malloc(value.size() + 1));
+    std::memcpy(copy, value.c_str(), value.size() + 1);
+    return copy;
+}
+
+} // namespace
+
+PluginRequest::PluginRequest(const char* function, const Args& args) {
+    initDataBlock(&data_block_);
+    initRequestData(&request_data_);
+    std::strncpy(request_data_.function, function, STRING_LENGTH - 1);
+
+    NAMEVALUELIST& list = request_data_.nameValueList;
+    list.pairCount = static_cast<int>(args.size());
+    list.listSize = static_cast<int>(args.size());
+    list.nameValue = static_cast<NAMEVALUE*>(std::calloc(std::max<size_t>(args.size(), 1), sizeof(NAMEVALUE)));
+    for (size_t i = 0; i < args.size(); ++i) {
+        const auto& [name, value] = args[i];
+        list.nameValue[i].pair = copy_string(name + "=" + value);
+        list.nameValue[i].name = copy_string(name);
+        list.nameValue[i].value = copy_string(value);
+    }
+
+    initUserDefinedTypeList(&userdefinedtypelist_);
+    initLogMallocList(&logmalloclist_);
+
+    interface_ = {};
+    interface_.interfaceVersion = 1;
+    interface_.data_block = &data_block_;
+    interface_.request_data = &request_data_;
+    interface_.userdefinedtypelist = &userdefinedtypelist_;
+    interface_.logmalloclist = &logmalloclist_;
+}
+
+PluginRequest::~PluginRequest() {
+    clear();
+    NAMEVALUELIST& list = request_data_.nameValueList;
+    for (int i = 0; i < list.pairCount; ++i) {
+        std::free(list.nameValue[i].pair);
+        std::free(list.nameValue[i].name);
+        std::free(list.nameValue[i].value);
+    }
+    std::free(list.nameValue);
+    list.nameValue = nullptr;
+    list.pairCount = 0;
+}
+
+void PluginRequest::clear() {
+    // Structures and their members are logged in the malloc log, other returned data is owned by the data block
+    if (data_block_.data_type != UDA_TYPE_COMPOUND) {
+        std::free(data_block_.data);
+        std::free(data_block_.dims);
+    }
+    freeMallocLogList(&logmalloclist_);
+    initLogMallocList(&logmalloclist_);
+    freeUserDefinedTypeList(&userdefinedtypelist_);
+    initUserDefinedTypeList(&userdefinedtypelist_);
+    initDataBlock(&data_block_);
+}
+
+std::vector<size_t> PluginRequest::shape() const {
+    std::vector<size_t> shape;
+    for (unsigned int i = 0; i < data_block_.rank; ++i) {
+        shape.push_back(static_cast<size_t>(data_block_.dims[i].dim_n));
+    }
+    return shape;
+}
+
+const COMPOUNDFIELD* PluginRequest::member(std::string_view name) const {
+    if (data_block_.data_type != UDA_TYPE_COMPOUND || data_block_.opaque_block == nullptr) {
+        return nullptr;
+    }
+    auto type = static_cast<const USERDEFINEDTYPE*>(data_block_.opaque_block);
+    for (int i = 0; i < type->fieldcount; ++i) {
+        if (name == type->compoundfield[i].name) {
+            return &type->compoundfield[i];
+        }
+    }
+    return nullptr;
+}
+
+const char* PluginRequest::member_data(std::string_view name, bool pointer) const {
+    const COMPOUNDFIELD* field = member(name);
+    if (field == nullptr || (field->pointer != 0) != pointer) {
+        return nullptr;
+    }
+    const char* data = data_block_.data + field->offset;
+    if (!pointer) {
+        return data;
+    }
+    const char* target;
+    std::memcpy(&target, data, sizeof(target));
+    return target;
+}
+
+} // namespace geometry_map_reader::test
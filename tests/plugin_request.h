@@ -0,0 +1,104 @@
+#ifndef GEOMETRY_MAP_READER_PLUGIN_REQUEST_H
+#define GEOMETRY_MAP_READER_PLUGIN_REQUEST_H
+
+#include <clientserver/udaStructs.h>
+#include <plugins/pluginStructs.h>
+#include <structures/genStructs.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Check a condition of a test, reporting it and failing the test if it does not hold. Unlike assert it is kept
+ * in release builds.
+ */
+#define GEOMETRY_CHECK(condition)                                                                                  \
+    do {                                                                                                           \
+        if (!(condition)) {                                                                                        \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                    \
+            std::exit(1);                                                                                          \
+        }                                                                                                          \
+    } while (0)
+
+namespace geometry_map_reader::test {
+
+/**
+ * A plugin call set up in memory as the UDA server would pass it: a request for a plugin function with name=value
+ * arguments (an empty value for a flag, eg. report_loss), and the data returned by the call. Members of a
+ * returned structure are read back by name. The request can be reused for several calls, calling clear() to
+ * release the data returned by the last one.
+ */
+class PluginRequest {
+  public:
+    using Args = std::vector<std::pair<std::string, std::string>>;
+
+    PluginRequest(const char* function, const Args& args);
+    PluginRequest(const PluginRequest&) = delete;
+    PluginRequest& operator=(const PluginRequest&) = delete;
+    ~PluginRequest();
+
+    [[nodiscard]] IDAM_PLUGIN_INTERFACE* interface() { return &interface_; }
+    [[nodiscard]] const DATA_BLOCK& data_block() const { return data_block_; }
+
+    /**
+     * @return the returned array or scalar as its data_n values
+     */
+    template <typename T> [[nodiscard]] std::vector<T> values() const {
+        const auto* data = reinterpret_cast<const T*>(data_block_.data);
+        return data != nullptr ? std::vector<T>(data, data + data_block_.data_n) : std::vector<T>{};
+    }
+
+    /**
+     * @return the shape of the returned array, empty for a scalar
+     */
+    [[nodiscard]] std::vector<size_t> shape() const;
+
+    /**
+     * @return the member of the returned structure, or nullptr if no structure was returned or it has no such
+     * member
+     */
+    [[nodiscard]] const COMPOUNDFIELD* member(std::string_view name) const;
+
+    template <typename T> [[nodiscard]] T scalar(std::string_view name) const {
+        T value{};
+        if (const char* data = member_data(name, false)) {
+            std::memcpy(&value, data, sizeof(T));
+        }
+        return value;
+    }
+
+    template <typename T> [[nodiscard]] const T* array(std::string_view name) const {
+        return reinterpret_cast<const T*>(member_data(name, true));
+    }
+
+    [[nodiscard]] std::string string(std::string_view name) const {
+        const char* value = member_data(name, true);
+        return value != nullptr ? value : "";
+    }
+
+    /**
+     * Release the data returned by the last call
+     */
+    void clear();
+
+  private:
+    /**
+     * @return the member's inline data, or the data it points to if pointer is set
+     */
+    [[nodiscard]] const char* member_data(std::string_view name, bool pointer) const;
+
+    DATA_BLOCK data_block_;
+    REQUEST_DATA request_data_;
+    USERDEFINEDTYPELIST userdefinedtypelist_;
+    LOGMALLOCLIST logmalloclist_;
+    IDAM_PLUGIN_INTERFACE interface_;
+};
+
+} // namespace geometry_map_reader::test
+
+#endif // GEOMETRY_MAP_READER_PLUGIN_REQUEST_H
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "geometry_plugin.h"
+#include "geometry_source_memory.h"
+#include "plugin_request.h"
+
+using geometry_map_reader::test::PluginRequest;
+
+namespace {
+
+/**
+ * A tree holding a closed rectangular wall spanning rmin..rmax and z -1..1
+ */
+std::shared_ptr<const geometry_map_reader::MemoryTreeNode> make_wall(double rmin, double rmax) {
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& wall = tree->add_child("wall");
+    const double r[] = {rmin, rmax, rmax, rmin, rmin};
+    const double z[] = {-1.0, -1.0, 1.0, 1.0, -1.0};
+    wall.add_array<double>("r", r, {5});
+    wall.add_array<double>("z", z, {5});
+    return tree;
+}
+
+/**
+ * The element trees of a small machine: the pickup probes p1 (0.25, 0), p2 (0.5, 0.5) and p3 (1.25, -0.5), the
+ * coil d1 of two 0.25 x 0.5 filaments centred on (0.75, 1) and (1, 1), and a rectangular wall contour spanning
+ * R 0.125..1.5 and Z -1.5..1.5. The values are exact in binary so boxes can touch elements exactly.
+ */
+void add_machine(geometry_map_reader::MemoryGeometrySource& memory, int source) {
+    auto probes = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    const double probe_r[] = {0.25, 0.5, 1.25};
+    const double probe_z[] = {0.0, 0.5, -0.5};
+    for (size_t i = 0; i < 3; ++i) {
+        auto& probe = probes->add_child("p" + std::to_string(i + 1));
+        probe.add_scalar<double>("r", probe_r[i]);
+        probe.add_scalar<double>("z", probe_z[i]);
+    }
+    memory.add(source, "/magnetics/pickup", 1, probes);
+
+    auto coils = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coil = coils->add_child("d1");
+    const double r[] = {0.75, 1.0};
+    const double z[] = {1.0, 1.0};
+    const double dr[] = {0.25, 0.25};
+    const double dz[] = {0.5, 0.5};
+    coil.add_array<double>("r", r, {2});
+    coil.add_array<double>("z", z, {2});
+    coil.add_array<double>("dr", dr, {2});
+    coil.add_array<double>("dz", dz, {2});
+    memory.add(source, "/magnetics/pfcoil", 1, coils);
+
+    auto wall = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& contour = wall->add_child("wall");
+    const double wall_r[] = {0.125, 1.5, 1.5, 0.125, 0.125};
+    const double wall_z[] = {-1.5, -1.5, 1.5, 1.5, -1.5};
+    contour.add_array<double>("r", wall_r, {5});
+    contour.add_array<double>("z", wall_z, {5});
+    memory.add(source, "/wall", 1, wall);
+}
+
+PluginRequest::Args machine_args(PluginRequest::Args args) {
+    args.insert(args.end(), {{"host", "localhost"}, {"port", "56565"}, {"source", "1"},
+                             {"signals", "/magnetics/pickup;/magnetics/pfcoil;/wall"}});
+    return args;
+}
+
+/**
+ * Pickup probes p0..p24 on a 5 x 5 lattice of pitch 0.25 from (0.5, -0.5), the flux loops f1..f3 and a coil that
+ * is not a sensor. Points on and between the lattice nodes are at equal distances from several probes.
+ */
+void add_sensors(geometry_map_reader::MemoryGeometrySource& memory, int source) {
+    auto probes = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    for (int i = 0; i < 25; ++i) {
+        auto& probe = probes->add_child("p" + std::to_string(i));
+        probe.add_scalar<double>("r", 0.5 + 0.25 * (i % 5));
+        probe.add_scalar<double>("z", -0.5 + 0.25 * (i / 5));
+    }
+    auto& coil = probes->add_child("d1");
+    const double r[] = {0.75, 1.0};
+    const double z[] = {1.0, 1.0};
+    coil.add_array<double>("r", r, {2});
+    coil.add_array<double>("z", z, {2});
+    coil.add_array<double>("dr", z, {2});
+    coil.add_array<double>("dz", z, {2});
+    memory.add(source, "/magnetics/pickup", 1, probes);
+
+    auto loops = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    const double loop_r[] = {1.0, 0.5, 1.5};
+    const double loop_z[] = {0.125, 0.875, -0.625};
+    for (size_t i = 0; i < 3; ++i) {
+        auto& loop = loops->add_child("f" + std::to_string(i + 1));
+        loop.add_scalar<double>("r", loop_r[i]);
+        loop.add_scalar<double>("z", loop_z[i]);
+    }
+    memory.add(source, "/magnetics/flux_loop", 1, loops);
+}
+
+/**
+ * Check the index and distance of a nearest result against a brute-force sort of the returned sensors by
+ * distance, then index
+ */
+void check_nearest(const PluginRequest& nearest, const std::vector<double>& r, const std::vector<double>& z,
+                   size_t k) {
+    const auto sensors = static_cast<size_t>(nearest.scalar<unsigned int>("count"));
+    const double* sensor_r = nearest.array<double>("r");
+    const double* sensor_z = nearest.array<double>("z");
+    const int* index = nearest.array<int>("index");
+    const double* distance = nearest.array<double>("distance");
+    const size_t count = std::min(k, sensors);
+
+    for (size_t point = 0; point < r.size(); ++point) {
+        std::vector<double> squared(sensors);
+        for (size_t i = 0; i < sensors; ++i) {
+            squared[i] = (sensor_r[i] - r[point]) * (sensor_r[i] - r[point]) +
+                         (sensor_z[i] - z[point]) * (sensor_z[i] - z[point]);
+        }
+        std::vector<size_t> order(sensors);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return squared[a] < squared[b]; });
+        for (size_t i = 0; i < count; ++i) {
+            GEOMETRY_CHECK(index[point * count + i] == static_cast<int>(order[i]));
+            GEOMETRY_CHECK(std::abs(distance[point * count + i] - std::sqrt(squared[order[i]])) <= 1e-12);
+        }
+    }
+}
+
+PluginRequest::Args source_args(const char* source, PluginRequest::Args args) {
+    args.insert(args.end(), {{"host", "localhost"}, {"port", "56565"}, {"source", source}, {"signals", "/wall"},
+                             {"contour", "wall"}});
+    return args;
+}
+
+/**
+ * Each source is tested against its own wall, whichever source was queried first
+ */
+void test_walls_per_source() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    memory.add(1, "/wall", 1, make_wall(0.5, 1.5));
+    memory.add(2, "/wall", 1, make_wall(1.0, 2.0));
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        PluginRequest inside_1{"inside", source_args("1", {{"r", "0.75;1.75"}, {"z", "0.0;0.0"}, {"distance", ""}})};
+        GEOMETRY_CHECK(plugin.inside(inside_1.interface()) == 0);
+        const unsigned char* mask = inside_1.array<unsigned char>("inside");
+        const double* distance = inside_1.array<double>("distance");
+        GEOMETRY_CHECK(mask[0] == 1 && mask[1] == 0);
+        GEOMETRY_CHECK(distance[0] == -0.25 && distance[1] == 0.25);
+
+        PluginRequest inside_2{"inside", source_args("2", {{"r", "0.75;1.75"}, {"z", "0.0;0.0"}, {"distance", ""}})};
+        GEOMETRY_CHECK(plugin.inside(inside_2.interface()) == 0);
+        mask = inside_2.array<unsigned char>("inside");
+        distance = inside_2.array<double>("distance");
+        GEOMETRY_CHECK(mask[0] == 0 && mask[1] == 1);
+        GEOMETRY_CHECK(distance[0] == 0.25 && distance[1] == -0.25);
+    }
+
+    // Wall masks over the same grid differ by source
+    PluginRequest mask_1{"wallmask", source_args("1", {{"nr", "5"}, {"nz", "3"}, {"rmin", "0.0"}, {"rmax", "2.0"}})};
+    GEOMETRY_CHECK(plugin.wallmask(mask_1.interface()) == 0);
+    PluginRequest mask_2{"wallmask", source_args("2", {{"nr", "5"}, {"nz", "3"}, {"rmin", "0.0"}, {"rmax", "2.0"}})};
+    GEOMETRY_CHECK(plugin.wallmask(mask_2.interface()) == 0);
+
+    // Grid points r = 0, 0.5, 1, 1.5, 2 on the middle row z = 0
+    const unsigned char* row_1 = mask_1.array<unsigned char>("inside") + 5;
+    const unsigned char* row_2 = mask_2.array<unsigned char>("inside") + 5;
+    GEOMETRY_CHECK(row_1[0] == 0 && row_1[2] == 1 && row_1[4] == 0);
+    GEOMETRY_CHECK(row_2[0] == 0 && row_2[1] == 0 && row_2[3] == 1);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * region returns, in tree order, the elements with a part in a closed box: probes as points, coils as their
+ * filament rectangles and walls as their edges, so that a box inside the wall does not find it
+ */
+void test_region() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    add_machine(memory, 1);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    struct Case {
+        const char* rmin;
+        const char* rmax;
+        const char* zmin;
+        const char* zmax;
+        const char* paths;
+    };
+    const Case cases[] = {
+        {"0.1875", "0.3125", "-0.125", "0.125", "p1"},         // around a probe, inside the wall
+        {"0.375", "0.75", "0.375", "1.0", "p2;d1"},            // a probe and the first coil filament
+        {"1.375", "1.625", "-0.125", "0.125", "wall"},         // across a wall edge
+        {"1.125", "1.25", "1.25", "1.375", "d1"},              // touching the corner of a coil filament
+        {"0.5", "0.5", "0.5", "0.5", "p2"},                    // a point box on a probe
+        {"0.875", "0.875", "0.0", "0.5", ""},                  // a line between the probes and the coil
+        {"1.625", "1.75", "1.625", "1.75", ""},                // outside everything
+        {"-2.0", "2.0", "-2.0", "2.0", "p1;p2;p3;d1;wall"},    // everything
+    };
+    for (const Case& box : cases) {
+        PluginRequest region{"region", machine_args({{"rmin", box.rmin}, {"rmax", box.rmax}, {"zmin", box.zmin},
+                                                     {"zmax", box.zmax}})};
+        GEOMETRY_CHECK(plugin.region(region.interface()) == 0);
+        GEOMETRY_CHECK(region.string("paths") == box.paths);
+        GEOMETRY_CHECK(region.string("failed_signals").empty());
+    }
+
+    PluginRequest all{"region", machine_args({{"rmin", "-2"}, {"rmax", "2"}, {"zmin", "-2"}, {"zmax", "2"}})};
+    GEOMETRY_CHECK(plugin.region(all.interface()) == 0);
+    GEOMETRY_CHECK(all.scalar<unsigned int>("count") == 5);
+    GEOMETRY_CHECK(all.string("signals") ==
+                   "/magnetics/pickup;/magnetics/pickup;/magnetics/pickup;/magnetics/pfcoil;/wall");
+    const double* rmin = all.array<double>("rmin");
+    const double* rmax = all.array<double>("rmax");
+    const double* zmin = all.array<double>("zmin");
+    const double* zmax = all.array<double>("zmax");
+    GEOMETRY_CHECK(rmin[2] == 1.25 && rmax[2] == 1.25 && zmin[2] == -0.5 && zmax[2] == -0.5);
+    GEOMETRY_CHECK(rmin[3] == 0.625 && rmax[3] == 1.125 && zmin[3] == 0.75 && zmax[3] == 1.25);
+    GEOMETRY_CHECK(rmin[4] == 0.125 && rmax[4] == 1.5 && zmin[4] == -1.5 && zmax[4] == 1.5);
+
+    // Only the signals requested are searched
+    PluginRequest probes{"region", {{"host", "localhost"}, {"port", "56565"}, {"source", "1"},
+                                    {"signals", "/magnetics/pickup"}, {"rmin", "-2"}, {"rmax", "2"},
+                                    {"zmin", "-2"}, {"zmax", "2"}}};
+    GEOMETRY_CHECK(plugin.region(probes.interface()) == 0);
+    GEOMETRY_CHECK(probes.string("paths") == "p1;p2;p3");
+
+    PluginRequest inverted{"region", machine_args({{"rmin", "1"}, {"rmax", "0"}, {"zmin", "0"}, {"zmax", "1"}})};
+    GEOMETRY_CHECK(plugin.region(inverted.interface()) != 0);
+
+    plugin.reset(init.interface());
+}
+
+/**
+ * nearest returns, per point, the k nearest sensors in the order of a brute-force sort with equal distances in
+ * index order, all of them when k exceeds their number, and none when no sensor matches
+ */
+void test_nearest() {
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource memory{stats};
+    add_sensors(memory, 1);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &memory);
+
+    // On a lattice node, at the centre of a cell, on a flux loop, beside the lattice and far from everything
+    const std::vector<double> r{1.0, 0.625, 1.0, 0.0, 3.0};
+    const std::vector<double> z{0.0, 0.125, 0.125, 0.0, 3.0};
+    const PluginRequest::Args points{{"host", "localhost"}, {"port", "56565"}, {"source", "1"},
+                                     {"signals", "/magnetics/pickup;/magnetics/flux_loop"},
+                                     {"r", "1.0;0.625;1.0;0.0;3.0"}, {"z", "0.0;0.125;0.125;0.0;3.0"}};
+
+    for (const char* k : {"1", "2", "4", "5", "9", "28", "40"}) {
+        PluginRequest::Args args = points;
+        args.emplace_back("k", k);
+        PluginRequest nearest{"nearest", args};
+        GEOMETRY_CHECK(plugin.nearest(nearest.interface()) == 0);
+        GEOMETRY_CHECK(nearest.scalar<unsigned int>("count") == 28);
+        check_nearest(nearest, r, z, std::stoul(k));
+    }
+
+    // Ties go to the lower index: the node then f1 and three of the node's four neighbours, the four probes
+    // around the cell centre then f1, and f1 then the probes either side of it
+    PluginRequest::Args args = points;
+    args.emplace_back("k", "5");
+    PluginRequest ties{"nearest", args};
+    GEOMETRY_CHECK(plugin.nearest(ties.interface()) == 0);
+    const int* index = ties.array<int>("index");
+    GEOMETRY_CHECK((std::vector<int>(index, index + 5) == std::vector<int>{12, 25, 7, 11, 13}));
+    GEOMETRY_CHECK((std::vector<int>(index + 5, index + 10) == std::vector<int>{10, 11, 15, 16, 25}));
+    GEOMETRY_CHECK((std::vector<int>(index + 10, index + 13) == std::vector<int>{25, 12, 17}));
+
+    PluginRequest::Args loop_args = points;
+    loop_args.insert(loop_args.end(), {{"k", "2"}, {"class", "flux_loop"}});
+    PluginRequest loops{"nearest", loop_args};
+    GEOMETRY_CHECK(plugin.nearest(loops.interface()) == 0);
+    GEOMETRY_CHECK(loops.scalar<unsigned int>("count") == 3);
+    GEOMETRY_CHECK(loops.string("paths") == "f1;f2;f3");
+    check_nearest(loops, r, z, 2);
+
+    // No sensor matches the class, or the signals hold none
+    PluginRequest::Args none_args = points;
+    none_args.insert(none_args.end(), {{"k", "3"}, {"class", "saddle"}});
+    PluginRequest none{"nearest", none_args};
+    GEOMETRY_CHECK(plugin.nearest(none.interface()) == 0);
+    GEOMETRY_CHECK(none.scalar<unsigned int>("count") == 0);
+    GEOMETRY_CHECK(none.string("paths").empty());
+
+    auto coils = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    auto& coil = coils->add_child("d1");
+    const double coil_r[] = {0.75, 1.0, 1.25};
+    const double coil_z[] = {1.0, 1.0, 1.0};
+    coil.add_array<double>("r", coil_r, {3});
+    coil.add_array<double>("z", coil_z, {3});
+    memory.add(1, "/magnetics/pfcoil", 1, coils);
+    PluginRequest no_sensors{"nearest", {{"host", "localhost"}, {"port", "56565"}, {"source", "1"},
+                                         {"signals", "/magnetics/pfcoil"}, {"r", "1.0"}, {"z", "0.0"}}};
+    GEOMETRY_CHECK(plugin.nearest(no_sensors.interface()) == 0);
+    GEOMETRY_CHECK(no_sensors.scalar<unsigned int>("count") == 0);
+
+    plugin.reset(init.interface());
+}
+
+} // namespace
+
+int main() {
+    test_walls_per_source();
+    test_region();
+    test_nearest();
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <unistd.h>
+
+#include "geometry_plugin.h"
+#include "geometry_source_memory.h"
+#include "plugin_request.h"
+
+using geometry_map_reader::test::PluginRequest;
+
+namespace {
+
+std::shared_ptr<const geometry_map_reader::MemoryTreeNode> make_coil(int turns) {
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    tree->add_child("coil").add_scalar<int>("turns", turns);
+    return tree;
+}
+
+/**
+ * Serves the trees of a different memory source per host, failing for unknown hosts
+ */
+class HostSource final : public geometry_map_reader::GeometrySource {
+  public:
+    void add(const std::string& host, geometry_map_reader::GeometrySource& source) { sources_[host] = &source; }
+
+    int fetch(const geometry_map_reader::GeometryCacheKey& key,
+              std::optional<geometry_map_reader::GeometryCacheEntry>& entry) override {
+        auto found = sources_.find(key.host);
+        return found != sources_.end() ? found->second->fetch(key, entry) : 1;
+    }
+
+  private:
+    std::map<std::string, geometry_map_reader::GeometrySource*> sources_;
+};
+
+PluginRequest::Args args(const char* host, const char* name, const char* value, const char* port = "56565") {
+    return {{"host", host}, {"port", port}, {"source", "1"}, {"signal", "/coil"}, {name, value}};
+}
+
+/**
+ * @return the turns of the coil as returned by GEOMETRY::get from host, or -1 if the request fails
+ */
+int get_turns(GeometryMapReaderPlugin& plugin, const char* host) {
+    PluginRequest get{"get", args(host, "key", "coil.turns")};
+    if (plugin.get(get.interface()) != 0) {
+        return -1;
+    }
+    return *reinterpret_cast<const int*>(get.data_block().data);
+}
+
+/**
+ * Stored trees are kept per endpoint, survive a reset and are dropped by invalidate
+ */
+void test_store_per_endpoint() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_store_test_" + std::to_string(getpid()));
+    setenv("GEOMETRY_STORE_DIR", directory.c_str(), 1);
+
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource server_a{stats};
+    geometry_map_reader::MemoryGeometrySource server_b{stats};
+    server_a.add(1, "/coil", 1, make_coil(5));
+    server_b.add(1, "/coil", 1, make_coil(7));
+    HostSource hosts;
+    hosts.add("a", server_a);
+    hosts.add("b", server_b);
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &hosts);
+
+    GEOMETRY_CHECK(get_turns(plugin, "a") == 5);
+    GEOMETRY_CHECK(get_turns(plugin, "b") == 7);
+
+    // After a reset the trees are read back from the store, each from its own endpoint
+    plugin.reset(init.interface());
+    plugin.init(init.interface());
+    HostSource unreachable;
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &unreachable);
+    GEOMETRY_CHECK(get_turns(plugin, "b") == 7);
+    GEOMETRY_CHECK(get_turns(plugin, "a") == 5);
+    GEOMETRY_CHECK(get_turns(plugin, "c") == -1);
+
+    // Invalidated trees are fetched again
+    server_a.add(1, "/coil", 1, make_coil(6));
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &hosts);
+    GEOMETRY_CHECK(get_turns(plugin, "a") == 5);
+    PluginRequest invalidate{"invalidate", args("a", "signals", "/COIL")};
+    GEOMETRY_CHECK(plugin.invalidate(invalidate.interface()) == 0);
+    GEOMETRY_CHECK(invalidate.scalar<unsigned int>("requested") == 1);
+    GEOMETRY_CHECK(invalidate.scalar<unsigned int>("cached") == 1);
+    GEOMETRY_CHECK(invalidate.scalar<unsigned int>("stored") == 1);
+    GEOMETRY_CHECK(get_turns(plugin, "a") == 6);
+    GEOMETRY_CHECK(get_turns(plugin, "b") == 7);
+
+    plugin.reset(init.interface());
+    unsetenv("GEOMETRY_STORE_DIR");
+    std::filesystem::remove_all(directory);
+}
+
+/**
+ * Trees of the file backend are read from their files on every fetch and never stored
+ */
+void test_file_backend_not_stored() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_store_test_" + std::to_string(getpid()));
+    setenv("GEOMETRY_STORE_DIR", directory.c_str(), 1);
+
+    GeometryMapReaderPlugin plugin;
+    PluginRequest init{"init", {}};
+    plugin.init(init.interface());
+
+    geometry_map_reader::PluginStats stats;
+    geometry_map_reader::MemoryGeometrySource files{stats};
+    // Files are not per source, so the file backend fetches every tree as source 0
+    files.add(0, "/coil", 1, make_coil(3));
+    plugin.set_source(geometry_map_reader::GeometryBackend::File, &files);
+
+    PluginRequest get{"get", {{"backend", "file"}, {"source", "1"}, {"signal", "/coil"}, {"key", "coil.turns"}}};
+    GEOMETRY_CHECK(plugin.get(get.interface()) == 0);
+    GEOMETRY_CHECK(*reinterpret_cast<const int*>(get.data_block().data) == 3);
+    GEOMETRY_CHECK(std::filesystem::is_empty(directory / "refs"));
+    GEOMETRY_CHECK(std::filesystem::is_empty(directory / "objects"));
+
+    // A GEOM server at an empty host is not answered with the file tree
+    HostSource hosts;
+    plugin.set_source(geometry_map_reader::GeometryBackend::Uda, &hosts);
+    PluginRequest uda{"get", args("", "key", "coil.turns", "0")};
+    GEOMETRY_CHECK(plugin.get(uda.interface()) != 0);
+
+    plugin.reset(init.interface());
+    unsetenv("GEOMETRY_STORE_DIR");
+    std::filesystem::remove_all(directory);
+}
+
+/**
+ * Objects whose records do not describe their data are not loaded
+ */
+void test_invalid_records() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_store_test_" + std::to_string(getpid()));
+    geometry_map_reader::GeometryStore store{directory.string()};
+
+    auto tree = std::make_shared<geometry_map_reader::MemoryTreeNode>("data");
+    const double r[] = {1.0, 2.0, 3.0, 4.0};
+    tree->add_child("coil").add_array<double>("r", r, {2, 2});
+    auto index = geometry_map_reader::GeometryIndex::build(geometry_map_reader::MemoryTreeRef{*tree});
+    geometry_map_reader::GeometryCacheKey key{"localhost", 56565, 1, "/coil", 1};
+    GEOMETRY_CHECK(store.save(key, index));
+    GEOMETRY_CHECK(store.load(key).has_value());
+
+    std::filesystem::path object = std::filesystem::directory_iterator{directory / "objects"}->path();
+    std::string contents;
+    {
+        std::ifstream in{object, std::ios::binary};
+        contents.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+    }
+
+    // Offsets of the fields of the single leaf record, after the 24 byte object header
+    constexpr size_t record = 24;
+    constexpr size_t data_bytes = record + 24;
+    constexpr size_t type = record + 36;
+    constexpr size_t rank = record + 40;
+    auto corrupt = [&](size_t offset, auto value) {
+        std::string corrupted = contents;
+        std::memcpy(&corrupted[offset], &value, sizeof(value));
+        std::ofstream out{object, std::ios::binary | std::ios::trunc};
+        out.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+        out.close();
+        return store.load(key).has_value();
+    };
+    GEOMETRY_CHECK(!corrupt(data_bytes, uint64_t{8}));
+    GEOMETRY_CHECK(!corrupt(data_bytes, uint64_t{64}));
+    GEOMETRY_CHECK(!corrupt(type, int32_t{UDA_TYPE_COMPOUND}));
+    GEOMETRY_CHECK(!corrupt(type, int32_t{-1}));
+    GEOMETRY_CHECK(!corrupt(rank, uint32_t{1}));
+    GEOMETRY_CHECK(!corrupt(rank, uint32_t{3}));
+    GEOMETRY_CHECK(corrupt(type, int32_t{UDA_TYPE_LONG64}));
+
+    std::filesystem::remove_all(directory);
+}
+
+/**
+ * Trees of scalars only, or of no leaves at all, are stored and read back
+ */
+void test_scalar_trees() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_store_test_" + std::to_string(getpid()));
+    geometry_map_reader::GeometryStore store{directory.string()};
+
+    auto tree = make_coil(4);
+    auto scalars = geometry_map_reader::GeometryIndex::build(geometry_map_reader::MemoryTreeRef{*tree});
+    geometry_map_reader::GeometryCacheKey key{"localhost", 56565, 1, "/coil", 1};
+    GEOMETRY_CHECK(store.save(key, scalars));
+    auto loaded = store.load(key);
+    GEOMETRY_CHECK(loaded.has_value() && *static_cast<const int*>(loaded->index->find("coil.turns")->data) == 4);
+
+    geometry_map_reader::GeometryIndex empty;
+    GEOMETRY_CHECK(store.save(key, empty));
+    loaded = store.load(key);
+    GEOMETRY_CHECK(loaded.has_value() && loaded->index->size() == 0);
+
+    std::filesystem::remove_all(directory);
+}
+
+/**
+ * An existing object is reused only if it holds the saved tree, and replaced otherwise
+ */
+void test_damaged_object_replaced() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_store_test_" + std::to_string(getpid()));
+    geometry_map_reader::GeometryStore store{directory.string()};
+
+    auto tree = make_coil(5);
+    auto index = geometry_map_reader::GeometryIndex::build(geometry_map_reader::MemoryTreeRef{*tree});
+    geometry_map_reader::GeometryCacheKey key{"localhost", 56565, 1, "/coil", 1};
+    GEOMETRY_CHECK(store.save(key, index));
+    std::filesystem::path object = std::filesystem::directory_iterator{directory / "objects"}->path();
+    auto size = std::filesystem::file_size(object);
+
+    for (uintmax_t damaged_size : {uintmax_t{0}, size / 2, size}) {
+        {
+            std::ofstream out{object, std::ios::binary | std::ios::trunc};
+            out << std::string(damaged_size, 'x');
+        }
+        GEOMETRY_CHECK(!store.load(key).has_value());
+        GEOMETRY_CHECK(store.save(key, index));
+        auto loaded = store.load(key);
+        GEOMETRY_CHECK(loaded.has_value() && *static_cast<const int*>(loaded->index->find("coil.turns")->data) == 5);
+    }
+
+    // No temporary files are left behind
+    size_t files = 0;
+    for (const char* subdirectory : {"objects", "refs"}) {
+        files += std::distance(std::filesystem::directory_iterator{directory / subdirectory},
+                               std::filesystem::directory_iterator{});
+    }
+    GEOMETRY_CHECK(files == 2);
+
+    std::filesystem::remove_all(directory);
+}
+
+/**
+ * collect deletes expired references, then the objects and temporary files no save could still be writing that
+ * no reference names
+ */
+void test_collect() {
+    auto directory = std::filesystem::temp_directory_path() / ("geometry_store_test_" + std::to_string(getpid()));
+    geometry_map_reader::GeometryStore store{directory.string(), std::chrono::seconds{3600}};
+    auto age = [](const std::filesystem::path& path, std::chrono::hours hours) {
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - hours);
+    };
+    auto count = [&](const char* subdirectory) {
+        return static_cast<size_t>(std::distance(std::filesystem::directory_iterator{directory / subdirectory},
+                                                 std::filesystem::directory_iterator{}));
+    };
+
+    geometry_map_reader::GeometryCacheKey removed{"localhost", 56565, 1, "/removed", 1};
+    geometry_map_reader::GeometryCacheKey expired{"localhost", 56565, 1, "/expired", 1};
+    geometry_map_reader::GeometryCacheKey kept{"localhost", 56565, 1, "/kept", 1};
+    geometry_map_reader::GeometryCacheKey shared{"localhost", 56565, 2, "/kept", 1};
+    auto save = [&](const geometry_map_reader::GeometryCacheKey& key, int turns) {
+        auto tree = make_coil(turns);
+        return store.save(key, geometry_map_reader::GeometryIndex::build(geometry_map_reader::MemoryTreeRef{*tree}));
+    };
+    GEOMETRY_CHECK(save(removed, 1) && save(expired, 2) && save(kept, 3) && save(shared, 3));
+    GEOMETRY_CHECK(store.remove(removed));
+    std::ofstream{directory / "objects" / "0123456789abcdef.geom.a1b2c3.tmp"} << "partial";
+    GEOMETRY_CHECK(count("objects") == 4 && count("refs") == 3);
+
+    // Recently written files are kept
+    GEOMETRY_CHECK(store.collect() == 0);
+
+    for (const auto& entry : std::filesystem::directory_iterator{directory / "objects"}) {
+        age(entry.path(), std::chrono::hours{1});
+    }
+    for (const auto& entry : std::filesystem::directory_iterator{directory / "refs"}) {
+        std::ifstream ref{entry.path()};
+        std::string hash;
+        std::string name;
+        std::getline(ref, hash);
+        std::getline(ref, name);
+        if (name.find("/expired") != std::string::npos) {
+            age(entry.path(), std::chrono::hours{2});
+        }
+    }
+    GEOMETRY_CHECK(store.collect() == 4);
+    GEOMETRY_CHECK(count("objects") == 1 && count("refs") == 2);
+    GEOMETRY_CHECK(store.load(kept).has_value() && store.load(shared).has_value());
+    GEOMETRY_CHECK(!store.load(expired).has_value() && !store.load(removed).has_value());
+
+    std::filesystem::remove_all(directory);
+}
+
+} // namespace
+
+int main() {
+    test_store_per_endpoint();
+    test_file_backend_not_stored();
+    test_invalid_records();
+    test_scalar_trees();
+    test_damaged_object_replaced();
+    test_collect();
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "geom_standin.h"
+
+#include <clientserver/initStructs.h>
+#include <clientserver/stringUtils.h>
+#include <clientserver/udaStructs.h>
+#include <clientserver/udaTypes.h>
+#include <plugins/pluginStructs.h>
+#include <plugins/udaPlugin.h>
+
+#include "utils/uda_structure_helpers.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Stand-in for the MAST-U GEOM plugin, serving synthetic GEOM::get trees from a local UDA server so the GEOMETRY
+ * plugin can be exercised end to end without the real GEOM service. The tree shape, latency and failure rate
+ * are set through the environment (see geom_standin.cfg.in). Trees are deterministic for a given signal.
+ */
+class GeomStandinPlugin {
+  public:
+    void init(IDAM_PLUGIN_INTERFACE* plugin_interface) {
+        REQUEST_DATA* request = plugin_interface->request_data;
+        if (!init_ || STR_IEQUALS(request->function, "init") || STR_IEQUALS(request->function, "initialise")) {
+            reset(plugin_interface);
+            // Initialise plugin
+            depth_ = env_value("GEOM_STANDIN_DEPTH", depth_);
+            fanout_ = env_value("GEOM_STANDIN_FANOUT", fanout_);
+            leaf_size_ = env_value("GEOM_STANDIN_LEAF_SIZE", leaf_size_);
+            latency_ms_ = env_value("GEOM_STANDIN_LATENCY_MS", latency_ms_);
+            jitter_ms_ = env_value("GEOM_STANDIN_JITTER_MS", jitter_ms_);
+            failure_rate_ = env_value("GEOM_STANDIN_FAILURE_RATE", failure_rate_);
+            init_ = true;
+        }
+    }
+    void reset(IDAM_PLUGIN_INTERFACE* plugin_interface) {
+        if (!init_) {
+            // Not previously initialised: Nothing to do!
+            return;
+        }
+        // Free Heap & reset counters
+        init_ = false;
+    }
+
+    int help(IDAM_PLUGIN_INTERFACE* plugin_interface);
+    int get(IDAM_PLUGIN_INTERFACE* plugin_interface);
+
+  private:
+    static constexpr double max_nodes = 1e6;
+
+    template <typename T> static T env_value(const char* name, T fallback) {
+        const char* value = std::getenv(name);
+        if (value == nullptr || value[0] == '\0') {
+            return fallback;
+        }
+        return static_cast<T>(std::strtod(value, nullptr));
+    }
+
+    void add_node(imas_json_plugin::uda_helpers::StructureBuilder& parent, IDAM_PLUGIN_INTERFACE* interface,
+                  std::string_view name, size_t level, double base);
+
+    bool init_ = false;
+    size_t depth_ = 3;
+    size_t fanout_ = 4;
+    size_t leaf_size_ = 64;
+    double latency_ms_ = 0.0;
+    double jitter_ms_ = 0.0;
+    double failure_rate_ = 0.0;
+    std::mt19937_64 random_{20240601};
+};
+
+int GeomStandin(IDAM_PLUGIN_INTERFACE* plugin_interface) {
+    //----------------------------------------------------------------------------------------
+    // Standard v1 Plugin Interface
+
+    if (plugin_interface->interfaceVersion > THISPLUGIN_MAX_INTERFACE_VERSION) {
+        RAISE_PLUGIN_ERROR("Plugin Interface Version Unknown to this plugin: Unable to execute the request!");
+    }
+
+    plugin_interface->pluginVersion = THISPLUGIN_VERSION;
+    REQUEST_DATA* request = plugin_interface->request_data;
+
+    try {
+        static GeomStandinPlugin plugin = {};
+        auto* const plugin_func = request->function;
+
+        if (plugin_interface->housekeeping || STR_IEQUALS(plugin_func, "reset")) {
+            plugin.reset(plugin_interface);
+            return 0;
+        }
+
+        //----------------------------------------------------------------------------------------
+        // Initialise
+        plugin.init(plugin_interface);
+        if (STR_IEQUALS(plugin_func, "init") || STR_IEQUALS(plugin_func, "initialise")) {
+            return 0;
+        }
+
+        //----------------------------------------------------------------------------------------
+        // Plugin Functions
+        //----------------------------------------------------------------------------------------
+
+        if (STR_IEQUALS(plugin_func, "help")) {
+            return plugin.help(plugin_interface);
+        } else if (STR_IEQUALS(plugin_func, "get")) {
+            return plugin.get(plugin_interface);
+        } else {
+            RAISE_PLUGIN_ERROR("Unknown function requested!");
+        }
+    } catch (const std::exception& ex) {
+        RAISE_PLUGIN_ERROR(ex.what());
+    }
+}
+
+/**
+ * Help: A Description of library functionality
+ * @param interface
+ * @return
+ */
+int GeomStandinPlugin::help(IDAM_PLUGIN_INTERFACE* interface) {
+    const char* help = "\nGEOM stand-in: get(signal=..., Config=...) returns a synthetic geometry tree\n\n";
+    const char* desc = "GEOM stand-in: help = description of this plugin";
+
+    return setReturnDataString(interface->data_block, help, desc);
+}
+
+/**
+ * Add a synthetic tree node: level 0 nodes hold the leaves, higher levels hold fanout child nodes n0, n1, ...
+ * Nodes of one level share a structure type.
+ */
+void GeomStandinPlugin::add_node(imas_json_plugin::uda_helpers::StructureBuilder& parent,
+                                 IDAM_PLUGIN_INTERFACE* interface, std::string_view name, size_t level,
+                                 double base) {
+    std::string type_name = "GeomStandinNode" + std::to_string(level);
+    imas_json_plugin::uda_helpers::StructureBuilder node{interface, type_name.c_str()};
+
+    if (level == 0) {
+        std::vector<double> values(leaf_size_);
+        std::vector<double> grid(2 * leaf_size_);
+        for (size_t i = 0; i < leaf_size_; ++i) {
+            values[i] = base + 0.5 * static_cast<double>(i);
+            grid[i] = base + 0.25 * static_cast<double>(i);
+            grid[leaf_size_ + i] = -grid[i];
+        }
+        const size_t grid_shape[] = {2, leaf_size_};
+        node.addArray<double>("values", gsl::span<const double>{values}, gsl::span<const size_t>{&leaf_size_, 1});
+        node.addArray<double>("grid", gsl::span<const double>{grid}, gsl::span<const size_t>{grid_shape});
+        node.addScalar<int>("count", static_cast<int>(leaf_size_));
+        node.addString("name", name);
+    } else {
+        for (size_t i = 0; i < fanout_; ++i) {
+            add_node(node, interface, "n" + std::to_string(i), level - 1, base + static_cast<double>(i));
+        }
+    }
+
+    parent.addStructure(name, node);
+}
+
+/**
+ * Return a synthetic tree in the layout of GEOM::get, ie. with the geometry under a member named data.
+ * Arguments: signal (required), Config (optional, default 1)
+ */
+int GeomStandinPlugin::get(IDAM_PLUGIN_INTERFACE* interface) {
+
+    REQUEST_DATA* request_data = interface->request_data;
+
+    const char* signal;
+    FIND_REQUIRED_STRING_VALUE(request_data->nameValueList, signal);
+
+    int config = 1;
+    FIND_INT_VALUE(request_data->nameValueList, config);
+
+    if (std::pow(static_cast<double>(fanout_), static_cast<double>(depth_)) > max_nodes) {
+        RAISE_PLUGIN_ERROR("GEOM stand-in tree is too large: reduce GEOM_STANDIN_DEPTH or GEOM_STANDIN_FANOUT");
+    }
+
+    double delay_ms = latency_ms_;
+    if (jitter_ms_ > 0.0) {
+        delay_ms += std::exponential_distribution<double>{1.0 / jitter_ms_}(random_);
+    }
+    if (delay_ms > 0.0) {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>{delay_ms});
+    }
+
+    if (failure_rate_ > 0.0 && std::uniform_real_distribution<double>{0.0, 1.0}(random_) < failure_rate_) {
+        UDA_LOG(UDA_LOG_DEBUG, "\nimas_json_plugin::plugin_helpers::get: Injected failure for %s\n", signal);
+        RAISE_PLUGIN_ERROR("Injected GEOM stand-in failure");
+    }
+
+    // Seed the leaf values from the signal and configuration so repeated requests return the same tree
+    double base = static_cast<double>(std::hash<std::string_view>{}(signal) % 1000 + config);
+
+    imas_json_plugin::uda_helpers::StructureBuilder root{interface, "GeomStandinResult"};
+    add_node(root, interface, "data", depth_, base);
+    return root.setReturnData("GEOM stand-in geometry tree");
+}
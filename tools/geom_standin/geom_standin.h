@@ -0,0 +1,21 @@
+#ifndef GEOM_STANDIN_PLUGIN_H
+#define GEOM_STANDIN_PLUGIN_H
+
+#include <clientserver/export.h>
+#include <plugins/udaPlugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define THISPLUGIN_VERSION 1
+#define THISPLUGIN_MAX_INTERFACE_VERSION 1 // Interface versions higher than this will not be understood!
+#define THISPLUGIN_DEFAULT_METHOD "help"
+
+LIBRARY_API [[maybe_unused]] int GeomStandin(IDAM_PLUGIN_INTERFACE* idam_plugin_interface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GEOM_STANDIN_PLUGIN_H
@@ -0,0 +1,143 @@
+/**
+ * Writes synthetic HDF5 geometry files for the GEOMETRY file backend, eg. for local tests without the real
+ * geometry files. The trees match those served by the GEOM stand-in plugin for the same signal and config, so
+ * both backends can be compared.
+ *
+ * Usage: geometry_fixture DIR SIGNAL [--config N] [--depth D] [--fanout F] [--leaf L]
+ *
+ * writes DIR/<config>/<signal>.h5 with fanout^depth groups n0.n1..., each holding a "values" dataset of leaf
+ * doubles, a 2 x leaf "grid" dataset, a scalar int "count" dataset and a "name" string attribute.
+ */
+#include <hdf5.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string directory;
+    std::string signal;
+    int config = 1;
+    size_t depth = 3;
+    size_t fanout = 4;
+    size_t leaf_size = 64;
+};
+
+int usage(const char* program) {
+    fmt::print(stderr, "Usage: {} DIR SIGNAL [--config N] [--depth D] [--fanout F] [--leaf L]\n", program);
+    return 2;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    if (argc < 3 || argc % 2 == 0) {
+        return false;
+    }
+    options.directory = argv[1];
+    options.signal = argv[2];
+    std::transform(options.signal.begin(), options.signal.end(), options.signal.begin(), ::tolower);
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        long value = std::atol(argv[i + 1]);
+        if (name == "--config") {
+            options.config = static_cast<int>(value);
+        } else if (name == "--depth") {
+            options.depth = static_cast<size_t>(value);
+        } else if (name == "--fanout") {
+            options.fanout = static_cast<size_t>(value);
+        } else if (name == "--leaf") {
+            options.leaf_size = static_cast<size_t>(value);
+        } else {
+            return false;
+        }
+    }
+    return options.signal.find("..") == std::string::npos;
+}
+
+void write_dataset(hid_t group, const char* name, hid_t type, const std::vector<hsize_t>& dims, const void* data) {
+    hid_t space = dims.empty() ? H5Screate(H5S_SCALAR) : H5Screate_simple(static_cast<int>(dims.size()), dims.data(),
+                                                                          nullptr);
+    hid_t dataset = H5Dcreate2(group, name, type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Dwrite(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    H5Dclose(dataset);
+    H5Sclose(space);
+}
+
+void write_string_attribute(hid_t group, const char* name, const std::string& value) {
+    hid_t type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, value.size());
+    hid_t space = H5Screate(H5S_SCALAR);
+    hid_t attribute = H5Acreate2(group, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attribute, type, value.data());
+    H5Aclose(attribute);
+    H5Sclose(space);
+    H5Tclose(type);
+}
+
+/**
+ * Write a node of the tree, with the same values as the GEOM stand-in plugin
+ */
+void write_node(hid_t group, const Options& options, const std::string& name, size_t level, double base) {
+    if (level == 0) {
+        size_t leaf_size = options.leaf_size;
+        std::vector<double> values(leaf_size);
+        std::vector<double> grid(2 * leaf_size);
+        for (size_t i = 0; i < leaf_size; ++i) {
+            values[i] = base + 0.5 * static_cast<double>(i);
+            grid[i] = base + 0.25 * static_cast<double>(i);
+            grid[leaf_size + i] = -grid[i];
+        }
+        int count = static_cast<int>(leaf_size);
+        write_dataset(group, "values", H5T_NATIVE_DOUBLE, {leaf_size}, values.data());
+        write_dataset(group, "grid", H5T_NATIVE_DOUBLE, {2, leaf_size}, grid.data());
+        write_dataset(group, "count", H5T_NATIVE_INT, {}, &count);
+        write_string_attribute(group, "name", name);
+        return;
+    }
+    for (size_t i = 0; i < options.fanout; ++i) {
+        std::string child_name = "n" + std::to_string(i);
+        hid_t child = H5Gcreate2(group, child_name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        write_node(child, options, child_name, level - 1, base + static_cast<double>(i));
+        H5Gclose(child);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return usage(argv[0]);
+    }
+
+    std::filesystem::path path = std::filesystem::path{options.directory} / std::to_string(options.config);
+    path /= std::filesystem::path{options.signal}.relative_path();
+    path += ".h5";
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) {
+        fmt::print(stderr, "Unable to create {}: {}\n", path.parent_path().string(), error.message());
+        return 1;
+    }
+
+    hid_t file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (file < 0) {
+        fmt::print(stderr, "Unable to create {}\n", path.string());
+        return 1;
+    }
+    hid_t root = H5Gopen2(file, "/", H5P_DEFAULT);
+    double base = static_cast<double>(std::hash<std::string_view>{}(options.signal) % 1000 + options.config);
+    write_node(root, options, "data", options.depth, base);
+    H5Gclose(root);
+    H5Fclose(file);
+
+    fmt::print("{}\n", path.string());
+    return 0;
+}
@@ -0,0 +1,222 @@
+/**
+ * Load generator for the GEOMETRY plugin: replays a mix of GEOMETRY requests from several concurrent clients
+ * against a UDA server and reports throughput and latency percentiles.
+ *
+ * Usage: geometry_load --host HOST --port PORT --requests FILE [--workers N] [--seconds S] [--warmup S]
+ *
+ * FILE holds one UDA signal per line, eg.
+ *   GEOMETRY::get(host=localhost, port=56565, source=45272, signal=/magnetics/pfcoil/d1_upper, key=n0.values)
+ * Blank lines and lines starting with '#' are skipped. Each worker replays the lines in order starting from its
+ * own offset. The UDA client keeps its connection state in process globals, so workers are separate processes
+ * rather than threads; each reports its latency histogram to the parent over a pipe.
+ */
+#include <c++/UDA.hpp>
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "geometry_stats.h"
+
+namespace {
+
+struct Options {
+    std::string host = "localhost";
+    int port = 56565;
+    std::string requests;
+    int workers = 4;
+    double seconds = 10.0;
+    double warmup = 1.0;
+};
+
+struct WorkerResult {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    geometry_map_reader::LatencyHistogram latency;
+};
+static_assert(std::is_trivially_copyable_v<WorkerResult>, "worker results are sent as raw bytes");
+
+int usage(const char* program) {
+    fmt::print(stderr,
+               "Usage: {} --host HOST --port PORT --requests FILE [--workers N] [--seconds S] [--warmup S]\n",
+               program);
+    return 2;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--host") {
+            options.host = value;
+        } else if (name == "--port") {
+            options.port = std::atoi(value);
+        } else if (name == "--requests") {
+            options.requests = value;
+        } else if (name == "--workers") {
+            options.workers = std::atoi(value);
+        } else if (name == "--seconds") {
+            options.seconds = std::atof(value);
+        } else if (name == "--warmup") {
+            options.warmup = std::atof(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && !options.requests.empty() && options.workers > 0;
+}
+
+std::vector<std::string> read_requests(const std::string& path) {
+    std::vector<std::string> requests;
+    std::ifstream file{path};
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line[0] != '#') {
+            requests.push_back(line);
+        }
+    }
+    return requests;
+}
+
+/**
+ * Replay the requests until the deadline, recording latencies only after the warm up
+ */
+WorkerResult run_worker(const Options& options, const std::vector<std::string>& requests, int worker) {
+    using clock = std::chrono::steady_clock;
+
+    uda::Client::setServerHostName(options.host);
+    uda::Client::setServerPort(options.port);
+    uda::Client client;
+
+    WorkerResult result;
+    auto seconds = [](double value) {
+        return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>{value});
+    };
+    auto measure_from = clock::now() + seconds(options.warmup);
+    auto deadline = measure_from + seconds(options.seconds);
+
+    size_t next = static_cast<size_t>(worker) % requests.size();
+    for (auto begin = clock::now(); begin < deadline; begin = clock::now()) {
+        bool failed = false;
+        try {
+            client.get(requests[next], "");
+        } catch (const std::exception&) {
+            failed = true;
+        }
+        auto end = clock::now();
+        next = next + 1 == requests.size() ? 0 : next + 1;
+
+        if (begin < measure_from) {
+            continue;
+        }
+        ++result.requests;
+        if (failed) {
+            ++result.errors;
+        } else {
+            result.latency.record(
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+        }
+    }
+    return result;
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size) {
+    auto bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = read(fd, bytes, size);
+        if (got <= 0) {
+            return false;
+        }
+        bytes += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return usage(argv[0]);
+    }
+
+    std::vector<std::string> requests = read_requests(options.requests);
+    if (requests.empty()) {
+        fmt::print(stderr, "No requests read from {}\n", options.requests);
+        return 1;
+    }
+
+    std::vector<int> pipes;
+    std::vector<pid_t> children;
+    for (int worker = 0; worker < options.workers; ++worker) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            fmt::print(stderr, "Unable to create a worker pipe: {}\n", std::strerror(errno));
+            return 1;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            fmt::print(stderr, "Unable to start a worker: {}\n", std::strerror(errno));
+            return 1;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            WorkerResult result = run_worker(options, requests, worker);
+            _exit(write_all(fds[1], &result, sizeof(WorkerResult)) ? 0 : 1);
+        }
+        close(fds[1]);
+        pipes.push_back(fds[0]);
+        children.push_back(pid);
+    }
+
+    WorkerResult total;
+    WorkerResult result;
+    int lost = 0;
+    for (int fd : pipes) {
+        if (read_all(fd, &result, sizeof(WorkerResult))) {
+            total.requests += result.requests;
+            total.errors += result.errors;
+            total.latency.merge(result.latency);
+        } else {
+            ++lost;
+        }
+        close(fd);
+    }
+    for (pid_t pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    const geometry_map_reader::LatencyHistogram& latency = total.latency;
+    fmt::print("workers      {}{}\n", options.workers, lost ? fmt::format(" ({} lost)", lost) : "");
+    fmt::print("requests     {}\n", total.requests);
+    fmt::print("errors       {}\n", total.errors);
+    fmt::print("throughput   {:.1f} requests/s\n", static_cast<double>(total.requests) / options.seconds);
+    fmt::print("latency ms   mean {:.3f}  p50 {:.3f}  p90 {:.3f}  p99 {:.3f}  p99.9 {:.3f}  max {:.3f}\n",
+               latency.mean() / 1e6, latency.percentile(0.5) / 1e6, latency.percentile(0.9) / 1e6,
+               latency.percentile(0.99) / 1e6, latency.percentile(0.999) / 1e6, latency.max() / 1e6);
+
+    return lost ? 1 : 0;
+}
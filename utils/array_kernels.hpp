@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gsl/gsl-lite.hpp"
+
+namespace imas_json_plugin::array_kernels {
+
+/**
+ * Convert a value to U. Floating point values converted to an integer type are rounded to the nearest integer,
+ * and conversions to an integer type saturate at its limits, with NaN converting to 0.
+ */
+template <typename U, typename T> U convert_value(T value) {
+    if constexpr (std::is_integral_v<U> && std::is_floating_point_v<T>) {
+        // Written with selects rather than early returns so that loops over it vectorise
+        const T rounded = std::nearbyint(value);
+        const bool low = rounded < static_cast<T>(std::numeric_limits<U>::min());
+        const bool high = rounded >= static_cast<T>(std::numeric_limits<U>::max());
+        const U converted = static_cast<U>(low || high || rounded != rounded ? T{0} : rounded);
+        return low ? std::numeric_limits<U>::min() : high ? std::numeric_limits<U>::max() : converted;
+    } else if constexpr (std::is_integral_v<U> && std::is_integral_v<T> && !std::is_same_v<U, T>) {
+        if constexpr (std::is_signed_v<T>) {
+            if (value < 0 && static_cast<long long>(value) < static_cast<long long>(std::numeric_limits<U>::min())) {
+                return std::numeric_limits<U>::min();
+            }
+        }
+        if (value > 0 &&
+            static_cast<unsigned long long>(value) > static_cast<unsigned long long>(std::numeric_limits<U>::max())) {
+            return std::numeric_limits<U>::max();
+        }
+        return static_cast<U>(value);
+    } else {
+        return static_cast<U>(value);
+    }
+}
+
+/**
+ * Accumulated precision loss of converted values
+ */
+struct ConversionLoss {
+    size_t count = 0;
+    size_t changed = 0;
+    double max_abs_error = 0.0;
+};
+
+/**
+ * Convert count values with convert_value. Without loss this is a plain element-wise loop (a copy for equal
+ * types) that the compiler vectorises for the target, eg. to AVX2 or NEON conversions.
+ *
+ * @param loss if not null, accumulates the values changed by the conversion and the largest absolute error
+ *             (NaN converted to an integer counts as changed without an error)
+ */
+template <typename T, typename U> void convert(const T* in, size_t count, U* out, ConversionLoss* loss = nullptr) {
+    if (loss == nullptr) {
+        if constexpr (std::is_same_v<T, U>) {
+            std::copy(in, in + count, out);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = convert_value<U>(in[i]);
+            }
+        }
+        return;
+    }
+
+    loss->count += count;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = convert_value<U>(in[i]);
+        // long double holds 64-bit integers exactly on the usual targets, so large integer changes are seen
+        const long double error = std::abs(static_cast<long double>(out[i]) - static_cast<long double>(in[i]));
+        const bool nan_lost = error != error && out[i] == out[i];
+        if (nan_lost) {
+            ++loss->changed;
+        } else if (error > 0) {
+            ++loss->changed;
+            loss->max_abs_error = std::max(loss->max_abs_error, static_cast<double>(error));
+        }
+    }
+}
+
+/**
+ * Reverse the axes of a row-major array, ie. convert between C and Fortran element order.
+ *
+ * The array is treated as a stack of (first axis x last axis) matrices, one per combination of the middle
+ * axes, and each matrix is transposed in tiles small enough that the tiles of both input and output stay in
+ * cache.
+ *
+ * @param in row-major input with the given shape
+ * @param out output of the same size, row-major with the shape reversed, converted with convert_value
+ * @param shape the input shape
+ */
+template <typename T, typename U> void reverse_axes(const T* in, U* out, gsl::span<const size_t> shape) {
+    constexpr size_t tile = 32;
+
+    const size_t rank = shape.size();
+    size_t count = 1;
+    for (size_t dim : shape) {
+        count *= dim;
+    }
+    if (rank < 2 || count == 0) {
+        convert(in, count, out);
+        return;
+    }
+
+    const size_t rows = shape[0];
+    const size_t cols = shape[rank - 1];
+    const size_t in_row_stride = count / rows;  // input stride of the first axis
+    const size_t out_col_stride = count / cols; // output stride of the last axis
+
+    // Odometer over the middle axes, tracking the input and output offsets of each matrix
+    std::vector<size_t> index(rank, 0);
+    size_t in_offset = 0;
+    size_t out_offset = 0;
+
+    for (size_t matrix = 0; matrix < count / (rows * cols); ++matrix) {
+        for (size_t i0 = 0; i0 < rows; i0 += tile) {
+            for (size_t j0 = 0; j0 < cols; j0 += tile) {
+                const size_t i1 = std::min(i0 + tile, rows);
+                const size_t j1 = std::min(j0 + tile, cols);
+                for (size_t i = i0; i < i1; ++i) {
+                    for (size_t j = j0; j < j1; ++j) {
+                        out[out_offset + j * out_col_stride + i] =
+                            convert_value<U>(in[in_offset + i * in_row_stride + j]);
+                    }
+                }
+            }
+        }
+
+        for (size_t axis = rank - 2; axis > 0; --axis) {
+            size_t in_stride = 1;
+            for (size_t k = axis + 1; k < rank; ++k) {
+                in_stride *= shape[k];
+            }
+            size_t out_stride = 1;
+            for (size_t k = 0; k < axis; ++k) {
+                out_stride *= shape[k];
+            }
+
+            if (++index[axis] < shape[axis]) {
+                in_offset += in_stride;
+                out_offset += out_stride;
+                break;
+            }
+            index[axis] = 0;
+            in_offset -= (shape[axis] - 1) * in_stride;
+            out_offset -= (shape[axis] - 1) * out_stride;
+        }
+    }
+}
+
+/**
+ * The elements selected along one axis: count elements from start, step apart (step may be negative)
+ */
+struct AxisRange {
+    size_t start = 0;
+    ptrdiff_t step = 1;
+    size_t count = 0;
+};
+
+/**
+ * Copy the sub-array selected by one range per axis of a row-major array into a contiguous row-major output.
+ *
+ * Walks the selected rows with an odometer over all but the last axis and copies each row with its stride, so
+ * only the selected elements are read.
+ *
+ * @param in row-major input with the given shape
+ * @param out output holding the product of the range counts, converted with convert_value
+ * @param shape the input shape
+ * @param ranges the range of each axis, all within the shape
+ */
+template <typename T, typename U>
+void copy_ranges(const T* in, U* out, gsl::span<const size_t> shape, gsl::span<const AxisRange> ranges) {
+    const size_t rank = shape.size();
+    size_t count = 1;
+    for (const AxisRange& range : ranges) {
+        count *= range.count;
+    }
+    if (rank == 0 || count == 0) {
+        convert(in, count, out);
+        return;
+    }
+
+    // Input offset of the first selected element and input stride between selected elements of each axis
+    std::vector<ptrdiff_t> strides(rank);
+    ptrdiff_t offset = 0;
+    ptrdiff_t stride = 1;
+    for (size_t axis = rank; axis-- > 0;) {
+        strides[axis] = stride * ranges[axis].step;
+        offset += static_cast<ptrdiff_t>(ranges[axis].start) * stride;
+        stride *= static_cast<ptrdiff_t>(shape[axis]);
+    }
+
+    const size_t row = ranges[rank - 1].count;
+    const ptrdiff_t row_stride = strides[rank - 1];
+    std::vector<size_t> index(rank, 0);
+
+    for (size_t rows = count / row; rows > 0; --rows) {
+        const T* src = in + offset;
+        if (row_stride == 1) {
+            convert(src, row, out);
+        } else {
+            for (size_t j = 0; j < row; ++j) {
+                out[j] = convert_value<U>(src[static_cast<ptrdiff_t>(j) * row_stride]);
+            }
+        }
+        out += row;
+
+        for (size_t axis = rank - 1; axis-- > 0;) {
+            if (++index[axis] < ranges[axis].count) {
+                offset += strides[axis];
+                break;
+            }
+            index[axis] = 0;
+            offset -= static_cast<ptrdiff_t>(ranges[axis].count - 1) * strides[axis];
+        }
+    }
+}
+
+/**
+ * Sum count values, integers exactly as long long and floating point values as double (NaN propagates).
+ *
+ * The values are summed into independent partial sums, which the compiler can keep in vector registers without
+ * reassociating the floating point additions itself.
+ */
+template <typename T> auto sum(const T* in, size_t count) {
+    using Sum = std::conditional_t<std::is_integral_v<T>, long long, double>;
+    constexpr size_t lanes = 8;
+
+    Sum partial[lanes] = {};
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        for (size_t j = 0; j < lanes; ++j) {
+            partial[j] += static_cast<Sum>(in[i + j]);
+        }
+    }
+    Sum total = 0;
+    for (; i < count; ++i) {
+        total += static_cast<Sum>(in[i]);
+    }
+    for (Sum value : partial) {
+        total += value;
+    }
+    return total;
+}
+
+/**
+ * The smallest and largest of count values, skipping NaN. If every value is NaN the minimum is greater than the
+ * maximum.
+ *
+ * Like sum, the values are compared in independent lanes so that the loop vectorises to packed min and max.
+ */
+template <typename T> std::pair<T, T> min_max(const T* in, size_t count) {
+    using Limits = std::numeric_limits<T>;
+    constexpr T highest = Limits::has_infinity ? Limits::infinity() : Limits::max();
+    constexpr T lowest = Limits::has_infinity ? -Limits::infinity() : Limits::lowest();
+    constexpr size_t lanes = 8;
+
+    T lo[lanes];
+    T hi[lanes];
+    std::fill(lo, lo + lanes, highest);
+    std::fill(hi, hi + lanes, lowest);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        for (size_t j = 0; j < lanes; ++j) {
+            // Comparisons with NaN are false, so NaN values leave the lanes unchanged
+            lo[j] = in[i + j] < lo[j] ? in[i + j] : lo[j];
+            hi[j] = in[i + j] > hi[j] ? in[i + j] : hi[j];
+        }
+    }
+    for (; i < count; ++i) {
+        lo[0] = in[i] < lo[0] ? in[i] : lo[0];
+        hi[0] = in[i] > hi[0] ? in[i] : hi[0];
+    }
+    return {*std::min_element(lo, lo + lanes), *std::max_element(hi, hi + lanes)};
+}
+
+} // namespace imas_json_plugin::array_kernels
@@ -1,8 +1,6 @@
 #pragma once
 
 #include <cstring>
-#include <typeinfo>
-#include <unordered_map>
 #include <valarray>
 #include <vector>
 
@@ -13,16 +11,33 @@
 
 namespace imas_json_plugin::uda_helpers {
 
-inline std::unordered_map<std::string, UDA_TYPE> uda_type_map() {
-    static std::unordered_map<std::string, UDA_TYPE> type_map;
-    if (type_map.empty()) {
-        type_map = {{typeid(unsigned int).name(), UDA_TYPE_UNSIGNED_INT},
-                    {typeid(int).name(), UDA_TYPE_INT},
-                    {typeid(float).name(), UDA_TYPE_FLOAT},
-                    {typeid(double).name(), UDA_TYPE_DOUBLE}};
-    }
-    return type_map;
-}
+/**
+ * Compile time mapping from a C++ type to its UDA type code and UDA type name
+ */
+template <typename T> struct uda_type_traits;
+
+#define UDA_TYPE_TRAITS(TYPE, CODE)                                                                                    \
+    template <> struct uda_type_traits<TYPE> {                                                                         \
+        static constexpr UDA_TYPE type = CODE;                                                                         \
+        static constexpr const char* name = #TYPE;                                                                     \
+    };
+
+UDA_TYPE_TRAITS(char, UDA_TYPE_CHAR)
+UDA_TYPE_TRAITS(unsigned char, UDA_TYPE_UNSIGNED_CHAR)
+UDA_TYPE_TRAITS(short, UDA_TYPE_SHORT)
+UDA_TYPE_TRAITS(unsigned short, UDA_TYPE_UNSIGNED_SHORT)
+UDA_TYPE_TRAITS(int, UDA_TYPE_INT)
+UDA_TYPE_TRAITS(unsigned int, UDA_TYPE_UNSIGNED_INT)
+UDA_TYPE_TRAITS(long, UDA_TYPE_LONG)
+UDA_TYPE_TRAITS(unsigned long, UDA_TYPE_UNSIGNED_LONG)
+UDA_TYPE_TRAITS(long long, UDA_TYPE_LONG64)
+UDA_TYPE_TRAITS(unsigned long long, UDA_TYPE_UNSIGNED_LONG64)
+UDA_TYPE_TRAITS(float, UDA_TYPE_FLOAT)
+UDA_TYPE_TRAITS(double, UDA_TYPE_DOUBLE)
+
+#undef UDA_TYPE_TRAITS
+
+template <typename T> constexpr UDA_TYPE uda_type_v = uda_type_traits<T>::type;
 
 int setReturnTimeArray(DATA_BLOCK* data_block);
 
@@ -39,16 +54,20 @@ template <typename T> int setReturnDataScalarType(DATA_BLOCK* data_block, T valu
     }
 
     data_block->rank = 0;
-    data_block->data_type = uda_type_map().at(typeid(T).name());
+    data_block->data_type = uda_type_v<T>;
     data_block->data = reinterpret_cast<char*>(data);
     data_block->data_n = 1;
 
     return 0;
 }
 
+/**
+ * Set an array as the return data, taking ownership of a buffer allocated with malloc. The buffer is freed
+ * along with the DATA_BLOCK, so values computed into their own buffer are returned without another copy.
+ */
 template <typename T>
-int setReturnDataArrayType(DATA_BLOCK* data_block, gsl::span<const T> values, gsl::span<const size_t> shape,
-                           const char* description = nullptr) {
+int setReturnDataArrayOwned(DATA_BLOCK* data_block, T* data, gsl::span<const size_t> shape,
+                            const char* description = nullptr) {
 
     initDataBlock(data_block);
 
@@ -82,10 +101,7 @@ int setReturnDataArrayType(DATA_BLOCK* data_block, gsl::span<const T> values, gs
         len *= shape_i;
     }
 
-    auto data = static_cast<T*>(malloc(len * sizeof(T)));
-    std::copy(values.begin(), values.end(), data);
-
-    data_block->data_type = uda_type_map().at(typeid(T).name());
+    data_block->data_type = uda_type_v<T>;
     data_block->data = reinterpret_cast<char*>(data);
     data_block->data_n = (int)len; // Not ideal....
 
@@ -93,81 +109,42 @@ int setReturnDataArrayType(DATA_BLOCK* data_block, gsl::span<const T> values, gs
 }
 
 template <typename T>
-int setReturnDataArrayType_Vec(DATA_BLOCK* data_block, const std::vector<T>& vec_values,
-                               const char* description = nullptr) {
-
-    initDataBlock(data_block);
+int setReturnDataArrayType(DATA_BLOCK* data_block, gsl::span<const T> values, gsl::span<const size_t> shape,
+                           const char* description = nullptr) {
 
-    if (description != nullptr) {
-        strncpy(data_block->data_desc, description, STRING_LENGTH);
-        data_block->data_desc[STRING_LENGTH - 1] = '\0';
+    size_t len = 1;
+    for (size_t dim : shape) {
+        len *= dim;
     }
 
-    const auto vec_size{vec_values.size()};
-    data_block->rank = 1;
-    data_block->dims = static_cast<DIMS*>(malloc(1 * sizeof(DIMS)));
-
-    auto dims = gsl::span(data_block->dims, data_block->rank);
-
-    initDimBlock(dims.data());
+    auto data = static_cast<T*>(malloc(len * sizeof(T)));
+    std::copy(values.begin(), values.end(), data);
 
-    dims[0].data_type = UDA_TYPE_UNSIGNED_INT;
+    return setReturnDataArrayOwned(data_block, data, shape, description);
+}
 
-    dims[0].dim_n = vec_size;
+template <typename T>
+int setReturnDataArrayType_Vec(DATA_BLOCK* data_block, const std::vector<T>& vec_values,
+                               const char* description = nullptr) {
 
-    // Always setting the dim to compressed initial value and spacing
-    dims[0].compressed = 1;
-    dims[0].dim0 = 0.0;
-    dims[0].diff = 1.0;
-    dims[0].method = 0;
+    const size_t vec_size{vec_values.size()};
 
     T* data = static_cast<T*>(malloc(vec_size * sizeof(T)));
     std::copy(vec_values.begin(), vec_values.end(), data);
 
-    data_block->data_type = uda_type_map().at(typeid(T).name());
-    data_block->data = reinterpret_cast<char*>(data);
-    data_block->data_n = (int)vec_size;
-
-    return 0;
+    return setReturnDataArrayOwned(data_block, data, gsl::span<const size_t>{&vec_size, 1}, description);
 }
 
 template <typename T>
 int setReturnDataValArray(DATA_BLOCK* data_block, const std::valarray<T>& va_values,
                           const char* description = nullptr) {
 
-    initDataBlock(data_block);
-
-    if (description != nullptr) {
-        strncpy(data_block->data_desc, description, STRING_LENGTH);
-        data_block->data_desc[STRING_LENGTH - 1] = '\0';
-    }
-
-    const auto va_size{va_values.size()};
-    data_block->rank = 1;
-    data_block->dims = static_cast<DIMS*>(malloc(1 * sizeof(DIMS)));
-
-    auto dims = gsl::span(data_block->dims, data_block->rank);
-
-    initDimBlock(dims.data());
-
-    dims[0].data_type = UDA_TYPE_UNSIGNED_INT;
-
-    dims[0].dim_n = va_size;
-
-    // Always setting the dim to compressed initial value and spacing
-    dims[0].compressed = 1;
-    dims[0].dim0 = 0.0;
-    dims[0].diff = 1.0;
-    dims[0].method = 0;
+    const size_t va_size{va_values.size()};
 
     T* data = static_cast<T*>(malloc(va_size * sizeof(T)));
     std::copy(std::begin(va_values), std::end(va_values), data);
 
-    data_block->data_type = uda_type_map().at(typeid(T).name());
-    data_block->data = reinterpret_cast<char*>(data);
-    data_block->data_n = (int)va_size;
-
-    return 0;
+    return setReturnDataArrayOwned(data_block, data, gsl::span<const size_t>{&va_size, 1}, description);
 }
 
 } // namespace imas_json_plugin::uda_helpers
@@ -0,0 +1,166 @@
+#include "utils/uda_structure_helpers.hpp"
+
+#include <algorithm>
+
+#include <plugins/udaPlugin.h>
+#include <structures/struct.h>
+
+namespace imas_json_plugin::uda_helpers {
+
+StructureBuilder::StructureBuilder(IDAM_PLUGIN_INTERFACE* interface, const char* type_name) : interface_{interface} {
+    initUserDefinedType(&type_);
+    type_.idamclass = UDA_TYPE_COMPOUND;
+    strncpy(type_.name, type_name, MAXELEMENTNAME - 1);
+    strncpy(type_.source, "GEOMETRY", MAXELEMENTNAME - 1);
+    type_.ref_id = 0;
+    type_.imagecount = 0;
+    type_.image = nullptr;
+}
+
+COMPOUNDFIELD StructureBuilder::initField(std::string_view name, std::string_view description) {
+    COMPOUNDFIELD field;
+    initCompoundField(&field);
+
+    // Structure member names cannot contain the '.' path separator
+    if (name.size() > static_cast<size_t>(MAXELEMENTNAME - 1) && error_ == nullptr) {
+        error_ = "Structure member name is too long";
+    }
+    auto name_len = std::min(name.size(), static_cast<size_t>(MAXELEMENTNAME - 1));
+    std::replace_copy(name.begin(), name.begin() + name_len, field.name, '.', '_');
+    field.name[name_len] = '\0';
+    if (!member_names_.emplace(field.name).second && error_ == nullptr) {
+        error_ = "Structure members have the same name once '.' is replaced by '_'";
+    }
+
+    auto desc_len = std::min(description.size(), static_cast<size_t>(MAXELEMENTNAME - 1));
+    std::copy(description.begin(), description.begin() + desc_len, field.desc);
+    field.desc[desc_len] = '\0';
+
+    field.rank = 0;
+    field.count = 1;
+    field.shape = nullptr;
+    return field;
+}
+
+void StructureBuilder::addString(std::string_view name, std::string_view value, std::string_view description) {
+    COMPOUNDFIELD field = initField(name, description);
+    field.atomictype = UDA_TYPE_STRING;
+    strncpy(field.type, "STRING", MAXELEMENTNAME - 1);
+    field.pointer = 1;
+    field.size = sizeof(char*);
+    field.alignment = alignof(char*);
+
+    auto data = static_cast<char*>(malloc(value.size() + 1));
+    if (data == nullptr) {
+        if (error_ == nullptr) {
+            error_ = "Failed to allocate the returned structure";
+        }
+        return;
+    }
+    std::copy(value.begin(), value.end(), data);
+    data[value.size()] = '\0';
+    addMalloc(interface_->logmalloclist, data, 1, value.size() + 1, "char");
+
+    auto offset = addField(field);
+    std::memcpy(&image_[offset], &data, sizeof(char*));
+}
+
+size_t StructureBuilder::addField(COMPOUNDFIELD& field) {
+    size_t offset = image_.size();
+    size_t padding = (field.alignment - offset % field.alignment) % field.alignment;
+    offset += padding;
+
+    field.offset = static_cast<int>(offset);
+    field.offpad = static_cast<int>(padding);
+    alignment_ = std::max(alignment_, static_cast<size_t>(field.alignment));
+
+    image_.resize(offset + field.size);
+    addCompoundField(&type_, field);
+    return offset;
+}
+
+void StructureBuilder::logArray(void* data, size_t count, size_t size, const char* type,
+                                gsl::span<const size_t> shape) {
+    if (shape.size() > 1) {
+        auto shape_int = static_cast<int*>(malloc(shape.size() * sizeof(int)));
+        if (shape_int != nullptr) {
+            std::copy(shape.begin(), shape.end(), shape_int);
+            addMalloc2(interface_->logmalloclist, data, static_cast<int>(count), size, type,
+                       static_cast<int>(shape.size()), shape_int);
+            return;
+        }
+        // The data is still logged, without its shape, so that it is freed with the request
+        if (error_ == nullptr) {
+            error_ = "Failed to allocate the returned structure";
+        }
+    }
+    addMalloc(interface_->logmalloclist, data, static_cast<int>(count), size, type);
+}
+
+void StructureBuilder::addStructure(std::string_view name, StructureBuilder& member, std::string_view description) {
+    COMPOUNDFIELD field = initField(name, description);
+    field.atomictype = UDA_TYPE_UNKNOWN;
+    strncpy(field.type, member.type_.name, MAXELEMENTNAME - 1);
+    field.pointer = 1;
+    field.size = sizeof(char*);
+    field.alignment = alignof(char*);
+
+    char* data = member.finalise();
+    if (member.error_ != nullptr && error_ == nullptr) {
+        error_ = member.error_;
+    }
+
+    auto offset = addField(field);
+    std::memcpy(&image_[offset], &data, sizeof(char*));
+}
+
+char* StructureBuilder::finalise() {
+    // Pad the structure to a multiple of its strictest member alignment, as the compiler would
+    image_.resize(image_.size() + (alignment_ - image_.size() % alignment_) % alignment_);
+    type_.size = static_cast<int>(image_.size());
+
+    auto data = static_cast<char*>(malloc(std::max<size_t>(image_.size(), 1)));
+    if (data == nullptr) {
+        if (error_ == nullptr) {
+            error_ = "Failed to allocate the returned structure";
+        }
+        return nullptr;
+    }
+    std::copy(image_.begin(), image_.end(), data);
+    addMalloc(interface_->logmalloclist, data, 1, image_.size(), type_.name);
+
+    if (findUserDefinedType(interface_->userdefinedtypelist, type_.name, 0) == nullptr) {
+        addUserDefinedType(interface_->userdefinedtypelist, type_);
+    }
+    return data;
+}
+
+int StructureBuilder::setReturnData(const char* description) {
+    if (error_ != nullptr) {
+        RAISE_PLUGIN_ERROR(error_);
+    }
+    char* data = finalise();
+    if (data == nullptr) {
+        RAISE_PLUGIN_ERROR(error_);
+    }
+    DATA_BLOCK* data_block = interface_->data_block;
+    initDataBlock(data_block);
+
+    if (description != nullptr) {
+        strncpy(data_block->data_desc, description, STRING_LENGTH);
+        data_block->data_desc[STRING_LENGTH - 1] = '\0';
+    }
+
+    data_block->rank = 0;
+    data_block->data_type = UDA_TYPE_COMPOUND;
+    data_block->data = data;
+    data_block->data_n = 1;
+    data_block->opaque_type = UDA_OPAQUE_TYPE_STRUCTURES;
+    data_block->opaque_count = 1;
+    data_block->opaque_block =
+        static_cast<void*>(findUserDefinedType(interface_->userdefinedtypelist, type_.name, 0));
+
+    return 0;
+}
+
+} // namespace imas_json_plugin::uda_helpers
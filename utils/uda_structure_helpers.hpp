@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <clientserver/udaStructs.h>
+#include <plugins/pluginStructs.h>
+#include <structures/genStructs.h>
+#include "gsl/gsl-lite.hpp"
+#include "utils/uda_plugin_helpers.hpp"
+
+namespace imas_json_plugin::uda_helpers {
+
+/**
+ * Builds a single UDA compound structure field by field and returns it in the plugin's DATA_BLOCK.
+ *
+ * Scalars are stored inline in the structure, arrays are stored as pointers to heap buffers registered
+ * with the plugin's malloc log (with their rank and shape) so the server can serialise them. Member names have
+ * '.' replaced by '_'; names that then collide or are too long for a UDA member name fail setReturnData.
+ */
+class StructureBuilder {
+  public:
+    StructureBuilder(IDAM_PLUGIN_INTERFACE* interface, const char* type_name);
+
+    template <typename T> void addScalar(std::string_view name, T value, std::string_view description = {}) {
+        COMPOUNDFIELD field = makeField<T>(name, description);
+        field.pointer = 0;
+        field.size = sizeof(T);
+        field.alignment = alignof(T);
+        field.count = 1;
+
+        auto offset = addField(field);
+        std::memcpy(&image_[offset], &value, sizeof(T));
+    }
+
+    template <typename T>
+    void addArray(std::string_view name, gsl::span<const T> values, gsl::span<const size_t> shape,
+                  std::string_view description = {}) {
+        auto data = static_cast<T*>(malloc(std::max<size_t>(values.size(), 1) * sizeof(T)));
+        if (data == nullptr) {
+            if (error_ == nullptr) {
+                error_ = "Failed to allocate the returned structure";
+            }
+            return;
+        }
+        std::copy(values.begin(), values.end(), data);
+        addOwnedArray(name, data, values.size(), shape, description);
+    }
+
+    /**
+     * Add an array member taking ownership of a buffer allocated with malloc, without copying it.
+     */
+    template <typename T>
+    void addOwnedArray(std::string_view name, T* data, size_t count, gsl::span<const size_t> shape,
+                       std::string_view description = {}) {
+        COMPOUNDFIELD field = makeField<T>(name, description);
+        field.pointer = 1;
+        field.size = sizeof(T*);
+        field.alignment = alignof(T*);
+
+        logArray(data, count, sizeof(T), uda_type_traits<T>::name, shape);
+
+        auto offset = addField(field);
+        std::memcpy(&image_[offset], &data, sizeof(T*));
+    }
+
+    void addString(std::string_view name, std::string_view value, std::string_view description = {});
+
+    /**
+     * Add a pointer member to a nested structure built by another builder. The member type is registered once
+     * per type name, so builders sharing a type name must add the same members in the same order.
+     */
+    void addStructure(std::string_view name, StructureBuilder& member, std::string_view description = {});
+
+    /**
+     * Register the structure type and set it as the plugin return data, or fail if a member could not be
+     * allocated or two members have the same name.
+     */
+    int setReturnData(const char* description = nullptr);
+
+  private:
+    template <typename T> COMPOUNDFIELD makeField(std::string_view name, std::string_view description) {
+        COMPOUNDFIELD field = initField(name, description);
+        field.atomictype = uda_type_v<T>;
+        strncpy(field.type, uda_type_traits<T>::name, MAXELEMENTNAME - 1);
+        return field;
+    }
+
+    COMPOUNDFIELD initField(std::string_view name, std::string_view description);
+    size_t addField(COMPOUNDFIELD& field);
+    void logArray(void* data, size_t count, size_t size, const char* type, gsl::span<const size_t> shape);
+
+    /**
+     * Pad the structure image, register its type and copy the image to a logged heap buffer
+     * @return the buffer, or nullptr if it could not be allocated
+     */
+    char* finalise();
+
+    IDAM_PLUGIN_INTERFACE* interface_;
+    USERDEFINEDTYPE type_;
+    std::vector<char> image_;
+    size_t alignment_ = 1;
+    std::unordered_set<std::string> member_names_;
+    // The first failure to add a member, reported by setReturnData
+    const char* error_ = nullptr;
+};
+
+} // namespace imas_json_plugin::uda_helpers